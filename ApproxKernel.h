@@ -0,0 +1,540 @@
+/*******************************************************************************
+ApproxKernel.h
+
+The 3-approximation of rSPR_worse_3_approx on compact arrays, for
+comparing one supertree against many binary gene trees
+
+Copyright 2009-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#ifndef INCLUDE_APPROXKERNEL
+#define INCLUDE_APPROXKERNEL
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "Node.h"
+#include "RsprContext.h"
+
+using namespace std;
+
+/*
+	rSPR_worse_3_approx_hlpr for two binary trees, run on arrays of
+	ApproxNodes instead of Forests.
+
+	The supertree is flattened once into an ApproxReference. For each
+	gene tree an ApproxKernel writes the supertree restricted to the gene
+	tree's leaves and a copy of the gene tree into arrays that it reuses,
+	and then makes its cuts in place. Nothing is allocated per comparison
+	and no undo log is kept, the next comparison simply overwrites the
+	arrays.
+
+	The kernel makes the same cuts in the same order as
+	rSPR_worse_3_approx_hlpr, including how Node::contract reorders
+	children, moves the twin of a root and leaves depths behind, so the
+	scores are equal. It only takes the cases where that is simple:
+	binary trees with numbered leaves that share at least two of them,
+	and no APPROX_EDGE_PROTECTION or
+	APPROX_REVERSE_CUT_ONE_B_2. approx() returns -1 for anything else and
+	the caller falls back to rSPR_worse_3_approx. Define
+	DEBUG_APPROX_KERNEL to check every score against it.
+*/
+
+// CLASSES
+
+struct ApproxNode {
+	int p;			// parent
+	int lc;			// first child
+	int rc;			// second child
+	int depth;	// as Node::get_depth would report it
+	int twin;		// counterpart in the other array
+};
+
+// a binary tree flattened in postorder, children before their parents
+class ApproxReference {
+	public:
+	vector<int> lc;
+	vector<int> rc;
+	// leaf number, or -1 for internal nodes
+	vector<int> number;
+	// the leaf numbers present
+	vector<bool> leaves;
+	// false if the kernel cannot compare against this tree
+	bool usable;
+
+	ApproxReference(Node *T) {
+		usable = true;
+		leaves = vector<bool>();
+		add(T);
+	}
+
+	bool contains(int leaf_number) {
+		return leaf_number < leaves.size() && leaves[leaf_number];
+	}
+
+	int add(Node *n) {
+		if (!n->can_be_sibling())
+			usable = false;
+		int l = -1;
+		int r = -1;
+		int leaf_number = -1;
+		if (n->is_leaf()) {
+			leaf_number = stomini(n->str());
+			if (leaf_number == INT_MAX)
+				usable = false;
+			else {
+				if (leaf_number >= leaves.size())
+					leaves.resize(leaf_number + 1, false);
+				if (leaves[leaf_number])
+					usable = false;
+				leaves[leaf_number] = true;
+			}
+		}
+		else if (n->get_children().size() != 2)
+			usable = false;
+		else {
+			l = add(n->lchild());
+			r = add(n->rchild());
+		}
+		lc.push_back(l);
+		rc.push_back(r);
+		number.push_back(leaf_number);
+		return lc.size() - 1;
+	}
+};
+
+class ApproxKernel {
+	private:
+	// the restricted supertree and the gene tree
+	vector<ApproxNode> F1;
+	vector<ApproxNode> F2;
+	int F1_root;
+	int F2_root;
+	// F2 leaf of each leaf number, or -1
+	vector<int> gene_leaf;
+	vector<int> gene_numbers;
+	vector<int> unshared;
+	// F1 node standing in for each reference node, or -1
+	vector<int> kept;
+	deque<int> sibling_pairs;
+	vector<int> singletons;
+
+	public:
+	ApproxKernel() {
+		F1_root = -1;
+		F2_root = -1;
+	}
+
+	/* number of cuts rSPR_worse_3_approx makes between reference,
+		 restricted to the leaves of gene_tree, and gene_tree, or -1 if the
+		 kernel does not handle this pair
+	*/
+	int approx(ApproxReference *reference, Node *gene_tree) {
+		if (!reference->usable || rspr_context()->APPROX_EDGE_PROTECTION
+				|| rspr_context()->APPROX_REVERSE_CUT_ONE_B_2)
+			return -1;
+		F1.clear();
+		F2.clear();
+		gene_numbers.clear();
+		bool ok = add_gene_node(gene_tree, gene_tree->get_depth() - 1, -1);
+		F2_root = 0;
+		if (ok)
+			ok = restrict(reference);
+		if (ok)
+			remove_unshared(reference);
+		for(int i = 0; i < gene_numbers.size(); i++)
+			gene_leaf[gene_numbers[i]] = -1;
+		if (!ok)
+			return -1;
+		sibling_pairs.clear();
+		singletons.clear();
+		for(int i = 0; i < F1.size(); i++) {
+			if (is_sibling_pair(F1, i)) {
+				sibling_pairs.push_back(F1[i].lc);
+				sibling_pairs.push_back(F1[i].rc);
+			}
+		}
+		return cut();
+	}
+
+	private:
+
+	/* copy the gene tree as the Node copy constructor would, whose nodes
+		 other than the root are one deeper than their original parent
+	*/
+	bool add_gene_node(Node *n, int parent_depth, int parent) {
+		int x = F2.size();
+		ApproxNode node = {parent, -1, -1, parent_depth + 1, -1};
+		if (parent < 0)
+			node.depth = n->get_depth();
+		F2.push_back(node);
+		if (n->is_leaf()) {
+			int leaf_number = stomini(n->str());
+			if (leaf_number == INT_MAX)
+				return false;
+			if (leaf_number >= gene_leaf.size())
+				gene_leaf.resize(leaf_number + 1, -1);
+			if (gene_leaf[leaf_number] >= 0)
+				return false;
+			gene_leaf[leaf_number] = x;
+			gene_numbers.push_back(leaf_number);
+			return true;
+		}
+		if (n->get_children().size() != 2)
+			return false;
+		int l = F2.size();
+		if (!add_gene_node(n->lchild(), n->get_depth(), x))
+			return false;
+		int r = F2.size();
+		if (!add_gene_node(n->rchild(), n->get_depth(), x))
+			return false;
+		F2[x].lc = l;
+		F2[x].rc = r;
+		return true;
+	}
+
+	/* the reference restricted to the gene tree's leaves, with its leaves
+		 twinned. This is the tree both Node::restricted_copy and removing
+		 the other leaves in sync_twins leave behind. The nodes are created
+		 in postorder, which is the order append_sibling_pairs_list finds
+		 sibling pairs in
+	*/
+	bool restrict(ApproxReference *reference) {
+		int n = reference->number.size();
+		kept.resize(n);
+		int num_leaves = 0;
+		for(int i = 0; i < n; i++) {
+			kept[i] = -1;
+			int leaf_number = reference->number[i];
+			if (leaf_number >= 0) {
+				if (leaf_number >= gene_leaf.size() || gene_leaf[leaf_number] < 0)
+					continue;
+				ApproxNode node = {-1, -1, -1, 0, gene_leaf[leaf_number]};
+				kept[i] = F1.size();
+				F2[node.twin].twin = F1.size();
+				F1.push_back(node);
+				num_leaves++;
+			}
+			else {
+				int l = kept[reference->lc[i]];
+				int r = kept[reference->rc[i]];
+				if (l < 0 || r < 0)
+					kept[i] = (l < 0 ? r : l);
+				else {
+					ApproxNode node = {-1, l, r, 0, -1};
+					kept[i] = F1.size();
+					F1[l].p = F1.size();
+					F1[r].p = F1.size();
+					F1.push_back(node);
+				}
+			}
+		}
+		F1_root = kept[n - 1];
+		// sync_twins gives up on trees it would reduce to one leaf
+		return num_leaves >= 2;
+	}
+
+	/* remove the gene tree leaves that are not in the reference, in the
+		 order sync_twins does, as that decides the depths left behind
+	*/
+	void remove_unshared(ApproxReference *reference) {
+		unshared.clear();
+		for(int i = 0; i < gene_numbers.size(); i++) {
+			if (!reference->contains(gene_numbers[i]))
+				unshared.push_back(gene_numbers[i]);
+		}
+		sort(unshared.begin(), unshared.end());
+		for(int i = 0; i < unshared.size(); i++) {
+			int leaf = gene_leaf[unshared[i]];
+			int parent = F2[leaf].p;
+			cut_parent(F2, leaf);
+			contract(F2, F1, parent);
+		}
+	}
+
+	static bool is_leaf(vector<ApproxNode> &F, int x) {
+		return F[x].lc < 0;
+	}
+
+	static bool is_sibling_pair(vector<ApproxNode> &F, int x) {
+		return F[x].lc >= 0 && is_leaf(F, F[x].lc)
+				&& F[x].rc >= 0 && is_leaf(F, F[x].rc);
+	}
+
+	static bool is_singleton(vector<ApproxNode> &F, int x) {
+		return F[x].p < 0 && is_leaf(F, x);
+	}
+
+	static int get_sibling(vector<ApproxNode> &F, int x) {
+		int p = F[x].p;
+		if (p < 0 || F[p].rc < 0)
+			return -1;
+		return (F[p].lc == x ? F[p].rc : F[p].lc);
+	}
+
+	static int find_root(vector<ApproxNode> &F, int x) {
+		while (F[x].p >= 0)
+			x = F[x].p;
+		return x;
+	}
+
+	static void cut_parent(vector<ApproxNode> &F, int x) {
+		int p = F[x].p;
+		if (p < 0)
+			return;
+		if (F[p].lc == x) {
+			F[p].lc = F[p].rc;
+			F[p].rc = -1;
+		}
+		else
+			F[p].rc = -1;
+		F[x].p = -1;
+	}
+
+	static void add_child(vector<ApproxNode> &F, int p, int x) {
+		cut_parent(F, x);
+		if (F[p].lc < 0)
+			F[p].lc = x;
+		else
+			F[p].rc = x;
+		F[x].p = p;
+		F[x].depth = F[p].depth + 1;
+	}
+
+	// Node::contract on node x of F, whose twins are in G
+	static int contract(vector<ApproxNode> &F, vector<ApproxNode> &G, int x) {
+		int parent = F[x].p;
+		if (parent >= 0) {
+			if (F[x].lc >= 0 && F[x].rc < 0) {
+				// the child takes our place
+				int child = F[x].lc;
+				if (F[parent].lc == x)
+					F[parent].lc = child;
+				else
+					F[parent].rc = child;
+				F[child].p = parent;
+				F[child].depth = F[x].depth;
+				F[x].p = -1;
+				F[x].lc = -1;
+				return parent;
+			}
+			else if (F[x].lc < 0) {
+				cut_parent(F, x);
+				return contract(F, G, parent);
+			}
+			return x;
+		}
+		if (F[x].lc < 0 || F[x].rc >= 0)
+			return -1;
+		// a root with one child takes the child's children and label
+		int child = F[x].lc;
+		if (is_leaf(F, child) && F[child].twin >= 0) {
+			F[x].twin = F[child].twin;
+			G[F[child].twin].twin = x;
+		}
+		cut_parent(F, child);
+		int l = F[child].lc;
+		int r = F[child].rc;
+		if (l >= 0)
+			add_child(F, x, l);
+		if (r >= 0)
+			add_child(F, x, r);
+		return x;
+	}
+
+	// the main loop of rSPR_worse_3_approx_hlpr
+	int cut() {
+		int num_cut = 0;
+		while(!singletons.empty() || !sibling_pairs.empty()) {
+			// Case 1 - Remove singletons
+			while(!singletons.empty()) {
+				int T2_a = singletons.back();
+				singletons.pop_back();
+				int T1_a = F2[T2_a].twin;
+				if (T2_a == F2_root)
+					continue;
+				int T1_a_parent = F1[T1_a].p;
+				if (T1_a_parent < 0)
+					continue;
+				bool potential_new_sibling_pair = is_sibling_pair(F1, T1_a_parent);
+				cut_parent(F1, T1_a);
+				int node = contract(F1, F2, T1_a_parent);
+				if (node >= 0 && potential_new_sibling_pair
+						&& is_sibling_pair(F1, node)) {
+					sibling_pairs.push_front(F1[node].rc);
+					sibling_pairs.push_front(F1[node].lc);
+				}
+			}
+			if (sibling_pairs.empty())
+				break;
+			int T1_a = sibling_pairs.back();
+			sibling_pairs.pop_back();
+			int T1_c = sibling_pairs.back();
+			sibling_pairs.pop_back();
+			int T1_ac = F1[T1_a].p;
+			if (T1_ac < 0 || T1_ac != F1[T1_c].p)
+				continue;
+			int T2_a = F1[T1_a].twin;
+			int T2_c = F1[T1_c].twin;
+
+			// Case 2 - Contract identical sibling pair
+			if (F2[T2_a].p >= 0 && F2[T2_a].p == F2[T2_c].p) {
+				int T2_ac = F2[T2_a].p;
+				cut_parent(F1, F1[T1_ac].rc);
+				cut_parent(F1, F1[T1_ac].lc);
+				cut_parent(F2, F2[T2_ac].rc);
+				cut_parent(F2, F2[T2_ac].lc);
+				F1[T1_ac].twin = T2_ac;
+				F2[T2_ac].twin = T1_ac;
+				if (is_singleton(F2, T2_ac) && T1_ac != F1_root
+						&& T2_ac != F2_root)
+					singletons.push_back(T2_ac);
+				int p = F1[T1_ac].p;
+				if (p >= 0 && is_sibling_pair(F1, p)) {
+					sibling_pairs.push_back(F1[p].lc);
+					sibling_pairs.push_back(F1[p].rc);
+				}
+				continue;
+			}
+
+			// Case 3
+			//  ensure T2_a is below T2_c
+			if ((F2[T2_a].depth < F2[T2_c].depth && F2[T2_c].p >= 0)
+					|| F2[T2_a].p < 0) {
+				swap(T1_a, T1_c);
+				swap(T2_a, T2_c);
+			}
+			else if (F2[T2_a].depth == F2[T2_c].depth) {
+				if (F2[T2_a].p >= 0 && F2[T2_c].p >= 0
+						&& F2[F2[T2_a].p].depth < F2[F2[T2_c].p].depth) {
+					swap(T1_a, T1_c);
+					swap(T2_a, T2_c);
+				}
+			}
+			int T2_ab = F2[T2_a].p;
+			if (T2_ab < 0)
+				return -1;
+			int T2_b = F2[T2_ab].rc;
+			if (T2_b == T2_a)
+				T2_b = F2[T2_ab].lc;
+			if (T2_b < 0)
+				return -1;
+
+			bool cut_a_only = false;
+			bool cut_b_only = false;
+			bool cut_c_only = false;
+			if (rspr_context()->APPROX_CUT_ONE_B && F2[T2_ab].p >= 0
+					&& F2[T2_ab].p == F2[T2_c].p) {
+				cut_b_only = true;
+				sibling_pairs.push_back(T1_c);
+				sibling_pairs.push_back(T1_a);
+			}
+			// APPROX_CUT_TWO_B and APPROX_CUT_TWO_B_ROOT need multifurcations
+			if (rspr_context()->APPROX_REVERSE_CUT_ONE_B && !cut_b_only && F1[T1_ac].p >= 0) {
+				int T1_s = get_sibling(F1, T1_ac);
+				if (T1_s < 0)
+					return -1;
+				if (is_leaf(F1, T1_s)) {
+					if (F1[T1_s].twin < 0)
+						return -1;
+					int T2_s_parent = F2[F1[T1_s].twin].p;
+					if (T2_s_parent == F2[T2_a].p)
+						cut_c_only = true;
+					else if (T2_s_parent == F2[T2_c].p) {
+						if (T2_s_parent < 0)
+							return -1;
+						cut_a_only = true;
+					}
+				}
+			}
+
+			int node = -1;
+			bool cut_a = false;
+			bool cut_c = false;
+			if (!cut_b_only) {
+				if (!cut_c_only) {
+					cut_parent(F1, T1_a);
+					cut_a = true;
+					node = contract(F1, F2, T1_ac);
+				}
+				else
+					node = T1_ac;
+				if (!cut_a_only) {
+					cut_parent(F1, T1_c);
+					cut_c = true;
+					if (node >= 0)
+						node = contract(F1, F2, node);
+				}
+				if (node >= 0 && is_sibling_pair(F1, node)) {
+					sibling_pairs.push_back(F1[node].lc);
+					sibling_pairs.push_back(F1[node].rc);
+				}
+			}
+
+			bool same_component = true;
+			if (rspr_context()->APPROX_CHECK_COMPONENT && !cut_a_only && !cut_c_only)
+				same_component = (find_root(F2, T2_a) == find_root(F2, T2_c));
+
+			int T2_ab_parent = F2[T2_ab].p;
+			node = T2_ab;
+			if (cut_a)
+				cut_parent(F2, T2_a);
+			bool cut_b = false;
+			if (same_component && T2_ab_parent >= 0
+					&& !cut_a_only && !cut_c_only) {
+				cut_parent(F2, T2_b);
+				cut_b = true;
+			}
+			// T2_b will move up after contraction
+			else
+				T2_b = F2[T2_b].p;
+			node = contract(F2, F1, node);
+			if (node >= 0 && is_singleton(F2, node) && node != F2_root)
+				singletons.push_back(node);
+
+			// contract might delete old T2_c, see where it is
+			T2_c = F1[T1_c].twin;
+			if (cut_c && T2_c != node && F2[T2_c].p >= 0) {
+				int T2_c_parent = F2[T2_c].p;
+				cut_parent(F2, T2_c);
+				node = contract(F2, F1, T2_c_parent);
+				if (node >= 0 && is_singleton(F2, node) && node != F2_root)
+					singletons.push_back(node);
+			}
+
+			if (cut_b && is_leaf(F2, T2_b))
+				singletons.push_back(T2_b);
+
+			num_cut += 3;
+		}
+		return num_cut;
+	}
+};
+
+#endif
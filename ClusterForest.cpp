@@ -0,0 +1,32 @@
+/*******************************************************************************
+ClusterForest.cpp
+
+
+Copyright 2011-2014 Chris Whidden
+cwhidden@dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#include "ClusterForest.h"
+
+void swap(ClusterForest **a, ClusterForest **b) {
+	(*a)->swap(*b);
+}
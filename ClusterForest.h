@@ -164,7 +164,5 @@ class ClusterForest: public Forest {
 // Functions
 
 // swap two cluster forests
-void swap(ClusterForest **a, ClusterForest **b) {
-	(*a)->swap(*b);
-}
+void swap(ClusterForest **a, ClusterForest **b);
 #endif
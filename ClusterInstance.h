@@ -295,142 +295,10 @@ class ClusterInstance {
 void cluster_reduction_find_components(Node *n,
 				vector<bool> *F2_cluster_copy_components,
 				vector<bool> *old_F2_keep_components,
-				int cluster_component_number) {
-	Node *lc = n->lchild();
-	Node *rc = n->rchild();
-	if (lc != NULL)
-		cluster_reduction_find_components(lc, F2_cluster_copy_components,
-				old_F2_keep_components, cluster_component_number);
-	if (rc != NULL)
-		cluster_reduction_find_components(rc, F2_cluster_copy_components,
-				old_F2_keep_components, cluster_component_number);
-	if (lc == NULL && rc == NULL) {
-		int cnumber = n->get_twin()->get_component_number();
-		if (cnumber != cluster_component_number) {
-			(*F2_cluster_copy_components)[cnumber] = true;
-			(*old_F2_keep_components)[cnumber] = false;
-		}
-	}
-}
+				int cluster_component_number);
 
 list<ClusterInstance> cluster_reduction(Forest *old_F1, Forest *old_F2,
-		list<Node *> *cluster_points) {
-	list<ClusterInstance> clusters = list<ClusterInstance>();
-	vector<bool> old_F2_keep_components =
-		vector<bool>(old_F2->num_components(), true);
-	for(list<Node *>::iterator i = cluster_points->begin();
-			i != cluster_points->end(); i++) {
-		// Cluster F1
-		Node *F1_root_node = *i;
-		Node *F1_cluster_node = F1_root_node->parent();
-//		Node *p = F1_cluster_node;
-//		while (p->parent() != NULL)
-//			p = p->parent();
-//		cout << "root address=" << &(*p) << endl;
-
-		F1_root_node->cut_parent();
-		vector<Node *> cluster_F1_components = vector<Node *>();
-		cluster_F1_components.push_back(F1_root_node);
-		Forest *F1 = new Forest(cluster_F1_components);
-
-		// Cluster F2
-		Node *F2_root_node = F1_root_node->get_twin();
-		Node *F2_cluster_node = F2_root_node->parent();
-		vector<bool> F2_cluster_copy_components =
-			vector<bool>(old_F2->num_components(), false);
-		int cnumber = F2_root_node->get_component_number();
-		bool F2_has_component_zero = false;
-		bool skip_F2_cluster = false;
-		if (F2_root_node->parent() != NULL) {
-			F2_root_node->cut_parent();
-		}
-		else {
-			if (old_F2_keep_components[cnumber] == false) {
-				skip_F2_cluster = true;
-			}
-			else if (old_F2->get_component(cnumber) == F2_root_node){
-				old_F2_keep_components[cnumber] = false;		
-				if (cnumber == 0) {
-					F2_has_component_zero = true;
-				}
-			}
-			else {
-//				if (F2_root_node->get_forest()->get_cluster()->F2_has_component_zero == false) {
-					F2_root_node->get_forest()->get_cluster()
-							->F2_has_component_zero = true;
-//					if (F2_root_node->get_forest()->contains_rho() == false)
-//						F2_root_node->get_forest()->add_rho();
-					F2_cluster_node = F2_root_node->get_forest()->get_cluster()->F2_cluster_node;
-//				}
-				skip_F2_cluster = true;
-			}
-		}
-
-		cluster_reduction_find_components(F1_root_node,
-				&F2_cluster_copy_components, &old_F2_keep_components, cnumber);
-		vector<Node *> cluster_F2_components = vector<Node *>();
-		if (!skip_F2_cluster)
-			cluster_F2_components.push_back(F2_root_node);
-		for(int i = 0; i < F2_cluster_copy_components.size(); i++) {
-			if (F2_cluster_copy_components[i] == true)
-				cluster_F2_components.push_back(old_F2->get_component(i));
-		}
-		Forest *F2 = new Forest(cluster_F2_components);
-		clusters.push_back(ClusterInstance(F1, F2, F1_cluster_node,
-					F2_cluster_node, F2_has_component_zero));
-		F1->set_cluster(clusters.back());
-		F2->set_cluster(clusters.back());
-		if (F1_cluster_node != NULL)
-			F1_cluster_node->increase_clustered_children();
-		if (F2_cluster_node != NULL)
-			F2_cluster_node->increase_clustered_children();
-		F1->label_nodes_with_forest();
-		F2->label_nodes_with_forest();
-		F1->set_twin(F2);
-		F2->set_twin(F1);
-
-		for(int i = 0; i < F2_cluster_copy_components.size(); i++) {
-			if (F2_cluster_copy_components[i] == true) {
-				cluster_F2_components.push_back(
-						(old_F2->get_component(i)));
-//				cout << "true " ;
-			}
-//			else
-//				cout << "false " ;
-		}
-//		cout << endl;
-	}
-	// remove any clustered components from old_F2
-	vector<Node *> old_F2_remaining_components = vector<Node *>();
-//	cout << "size=" << old_F2->num_components() << endl;
-	for(int i = 0; i < old_F2_keep_components.size(); i++) {
-		if (old_F2_keep_components[i] == true) {
-			old_F2_remaining_components.push_back(
-					(old_F2->get_component(i)));
-//			cout << "true " ;
-		}
-//		else
-//			cout << "false " ;
-	}
-//	cout << endl;
-//	cout << endl;
-	Forest *replace_old_F2 = new Forest(old_F2_remaining_components);
-	replace_old_F2->swap(old_F2);
-	replace_old_F2->erase_components();
-	delete replace_old_F2;
-
-
-	clusters.push_back(ClusterInstance(old_F1, old_F2, NULL, NULL, true));
-	old_F1->set_cluster(clusters.back());
-	old_F2->set_cluster(clusters.back());
-	old_F1->label_nodes_with_forest();
-	old_F2->label_nodes_with_forest();
-	old_F1->set_twin(old_F2);
-	old_F2->set_twin(old_F1);
-
-	return clusters;
-
-}
+		list<Node *> *cluster_points);
 
 
 #endif
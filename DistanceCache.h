@@ -0,0 +1,359 @@
+/*******************************************************************************
+DistanceCache.h
+
+Persistent cache of rSPR distances between pairs of trees
+
+Copyright 2009-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#ifndef INCLUDE_DISTANCECACHE
+#define INCLUDE_DISTANCECACHE
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <list>
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Node.h"
+
+using namespace std;
+
+/*
+	A cache of rSPR distances that persists across runs.
+
+	Each pair of trees is keyed by a 128-bit hash of its two canonical
+	trees, with children in sorted order and leaves by their original
+	labels, so the key does not depend on the input order of the trees,
+	their children or their taxa. Trees on different taxon sets hash
+	differently. A record holds a proven lower and upper bound on the
+	distance, equal when the distance is exact, and a mode for options
+	that change what distance is computed.
+
+	The file is a sequence of fixed-size records that is only ever
+	appended to, with one write per record under a shared file lock.
+	Readers map the file and index every complete record with a valid
+	checksum. A record torn by a crash or a failed write is skipped by
+	searching forward, a byte at a time, for the next record with a valid
+	checksum, so the records after it are still read even if other
+	processes kept appending. A tail with no valid record after it may
+	still be being written, and is read again on the next miss. When the
+	file is opened, and after a failed write, such a tail is cut off
+	under an exclusive lock. Records appended by other processes are
+	picked up on the next miss.
+*/
+
+// CLASSES
+
+struct DistanceRecord {
+	unsigned long long key1;
+	unsigned long long key2;
+	int lower;
+	int upper;
+	unsigned int mode;
+	unsigned int check;
+};
+
+class DistanceCache {
+	private:
+	struct Key {
+		unsigned long long key1;
+		unsigned long long key2;
+		unsigned int mode;
+		bool operator==(const Key &k) const {
+			return key1 == k.key1 && key2 == k.key2 && mode == k.mode;
+		}
+	};
+	struct KeyHash {
+		size_t operator()(const Key &k) const {
+			return (size_t)(k.key1 ^ (k.key2 * 0x9e3779b97f4a7c15ULL) ^ k.mode);
+		}
+	};
+
+	int fd;
+	// offset after the last valid record indexed
+	off_t indexed;
+	unordered_map<Key, pair<int, int>, KeyHash> index;
+	map<int, string> *reverse_label_map;
+
+	static unsigned int checksum(const DistanceRecord &r) {
+		unsigned long long h = mix(r.key1 ^ mix(r.key2 ^ mix(
+				((unsigned long long)(unsigned int)r.lower << 32
+				| (unsigned int)r.upper) ^ mix(r.mode + 1))));
+		return (unsigned int)(h ^ (h >> 32));
+	}
+
+	// canonical hash of the subtree rooted at n, with seed picking one
+	// of two independent hashes
+	unsigned long long tree_hash(Node *n, unsigned long long seed) {
+		if (n->is_leaf()) {
+			string label = n->get_name();
+			if (reverse_label_map != NULL) {
+				map<int, string>::iterator l =
+						reverse_label_map->find(atoi(label.c_str()));
+				if (l != reverse_label_map->end())
+					label = l->second;
+			}
+			unsigned long long h = seed;
+			for(int i = 0; i < label.size(); i++)
+				h = (h ^ (unsigned char)label[i]) * 0x100000001b3ULL;
+			return mix(h);
+		}
+		vector<unsigned long long> child_hashes =
+				vector<unsigned long long>();
+		list<Node *>::iterator c;
+		for(c = n->get_children().begin(); c != n->get_children().end(); c++)
+			child_hashes.push_back(tree_hash(*c, seed));
+		sort(child_hashes.begin(), child_hashes.end());
+		unsigned long long h = mix(seed ^ child_hashes.size());
+		for(int i = 0; i < child_hashes.size(); i++)
+			h = mix(h ^ child_hashes[i]) * 0x9e3779b97f4a7c15ULL;
+		return mix(h);
+	}
+
+	Key make_key(Node *T1, Node *T2, unsigned int mode) {
+		unsigned long long a1 = tree_hash(T1, 0xcbf29ce484222325ULL);
+		unsigned long long a2 = tree_hash(T1, 0x84222325cbf29ce4ULL);
+		unsigned long long b1 = tree_hash(T2, 0xcbf29ce484222325ULL);
+		unsigned long long b2 = tree_hash(T2, 0x84222325cbf29ce4ULL);
+		// the distance is symmetric
+		if (b1 < a1 || (b1 == a1 && b2 < a2)) {
+			swap(a1, b1);
+			swap(a2, b2);
+		}
+		Key k;
+		k.key1 = mix(a1) ^ b1;
+		k.key2 = mix(a2 ^ 0x9e3779b97f4a7c15ULL) ^ b2;
+		k.mode = mode;
+		return k;
+	}
+
+	void add_to_index(const Key &k, int lower, int upper) {
+		unordered_map<Key, pair<int, int>, KeyHash>::iterator i =
+				index.find(k);
+		if (i == index.end()) {
+			index[k] = make_pair(lower, upper);
+			return;
+		}
+		if (lower > i->second.first)
+			i->second.first = lower;
+		if (upper < i->second.second)
+			i->second.second = upper;
+	}
+
+	/* index the valid records from offset from to the end of the file,
+		 searching past torn records. Returns the offset after the last
+		 valid record, where any torn or unfinished tail starts
+	*/
+	off_t scan(off_t from) {
+		struct stat s;
+		if (fstat(fd, &s) != 0 || s.st_size - from < (off_t)sizeof(DistanceRecord))
+			return from;
+		// mmap offsets must be page aligned
+		off_t start = from - from % sysconf(_SC_PAGE_SIZE);
+		size_t length = s.st_size - start;
+		void *data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, start);
+		if (data == MAP_FAILED)
+			return from;
+		const char *bytes = (const char *)data - start;
+		off_t last = from;
+		off_t p = from;
+		while (p + (off_t)sizeof(DistanceRecord) <= s.st_size) {
+			// records after a torn one need not be aligned
+			DistanceRecord r;
+			memcpy(&r, bytes + p, sizeof(r));
+			if (r.check != checksum(r)) {
+				p++;
+				continue;
+			}
+			Key k;
+			k.key1 = r.key1;
+			k.key2 = r.key2;
+			k.mode = r.mode;
+			add_to_index(k, r.lower, r.upper);
+			p += sizeof(r);
+			last = p;
+		}
+		munmap(data, length);
+		return last;
+	}
+
+	// index the records appended since the last call
+	void load() {
+		indexed = scan(indexed);
+	}
+
+	/* cut a torn tail off the file. Writers hold a shared lock, so no
+		 record is being appended while we hold this one
+	*/
+	void trim() {
+		if (flock(fd, LOCK_EX) != 0)
+			return;
+		load();
+		struct stat s;
+		if (fstat(fd, &s) == 0 && s.st_size > indexed) {
+			if (ftruncate(fd, indexed) != 0)
+				cerr << "warning: could not repair the distance cache" << endl;
+		}
+		flock(fd, LOCK_UN);
+	}
+
+	public:
+	// the 64-bit finalizer of MurmurHash3
+	static unsigned long long mix(unsigned long long h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	DistanceCache() {
+		fd = -1;
+		indexed = 0;
+		reverse_label_map = NULL;
+	}
+
+	~DistanceCache() {
+		close();
+	}
+
+	// open or create the cache file, returns false on failure
+	bool open(const string &file) {
+		close();
+		fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+		if (fd < 0)
+			return false;
+		trim();
+		return true;
+	}
+
+	void close() {
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+		indexed = 0;
+		index.clear();
+	}
+
+	bool is_open() {
+		return fd >= 0;
+	}
+
+	int size() {
+		return index.size();
+	}
+
+	/* hash leaves by their original labels rather than the numbers
+		 they were assigned in this run
+	*/
+	void set_labels(map<int, string> *reverse_label_map) {
+		this->reverse_label_map = reverse_label_map;
+	}
+
+	/* find the known bounds on the distance between T1 and T2.
+		 Returns false if nothing is known
+	*/
+	bool lookup(Node *T1, Node *T2, unsigned int mode, int *lower,
+			int *upper) {
+		if (fd < 0)
+			return false;
+		Key k = make_key(T1, T2, mode);
+		bool found = false;
+		#pragma omp critical(rspr_distance_cache)
+		{
+			unordered_map<Key, pair<int, int>, KeyHash>::iterator i =
+					index.find(k);
+			if (i == index.end()) {
+				load();
+				i = index.find(k);
+			}
+			if (i != index.end()) {
+				*lower = i->second.first;
+				*upper = i->second.second;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// lookup an exact distance, -1 if it is not known
+	int lookup_exact(Node *T1, Node *T2, unsigned int mode) {
+		int lower;
+		int upper;
+		if (lookup(T1, T2, mode, &lower, &upper) && lower == upper)
+			return lower;
+		return -1;
+	}
+
+	/* record that lower <= distance(T1, T2) <= upper, with INT_MAX for
+		 an unknown upper bound. Bounds that add nothing are not written
+	*/
+	void record(Node *T1, Node *T2, unsigned int mode, int lower, int upper) {
+		if (fd < 0)
+			return;
+		DistanceRecord r;
+		Key k = make_key(T1, T2, mode);
+		r.key1 = k.key1;
+		r.key2 = k.key2;
+		r.lower = lower;
+		r.upper = upper;
+		r.mode = mode;
+		r.check = checksum(r);
+		#pragma omp critical(rspr_distance_cache)
+		{
+			unordered_map<Key, pair<int, int>, KeyHash>::iterator i =
+					index.find(k);
+			if (i == index.end() || lower > i->second.first
+					|| upper < i->second.second) {
+				flock(fd, LOCK_SH);
+				bool written = (write(fd, &r, sizeof(r)) == sizeof(r));
+				flock(fd, LOCK_UN);
+				if (!written) {
+					cerr << "warning: could not write to the distance cache"
+						<< endl;
+					trim();
+				}
+				add_to_index(k, lower, upper);
+			}
+		}
+	}
+
+	void record_exact(Node *T1, Node *T2, unsigned int mode, int distance) {
+		record(T1, T2, mode, distance, distance);
+	}
+};
+
+#endif
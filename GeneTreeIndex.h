@@ -0,0 +1,160 @@
+/*******************************************************************************
+GeneTreeIndex.h
+
+Data about a fixed set of gene trees that is reused while they are
+compared against many different supertrees
+
+Copyright 2009-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#ifndef INCLUDE_GENETREEINDEX
+#define INCLUDE_GENETREEINDEX
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include "Node.h"
+#include "LCA.h"
+
+using namespace std;
+
+/*
+	An index of the leaf numbers in each gene tree, built once before a
+	supertree search.
+
+	Comparing a supertree T1 against a gene tree T2 first copies T1 and
+	then removes every leaf that is not in T2, which dominates the setup
+	when the gene trees cover a small part of the supertree. With the
+	index, T1 is copied restricted to the leaves of T2 instead, so the
+	copy and everything after it only pays for the shared leaves.
+
+	Each gene tree is also numbered in preorder, with edge intervals, and
+	its LCA tables are built once here. The copy of T2 in a comparison
+	keeps these numbers and queries the tables instead of building its
+	own, see LCA::share.
+
+	The gene trees are found by their root. They must be added again
+	after they are rerooted or their leaves change. Comparisons are
+	read-only and can run in parallel.
+*/
+
+// CLASSES
+
+class GeneTreeIndex {
+	private:
+	// leaf numbers present in each gene tree
+	unordered_map<Node *, vector<bool> > taxa;
+	// LCA tables of each gene tree
+	unordered_map<Node *, LCA> lcas;
+
+	void number(Node *gene_tree, LCA *lca) {
+		clear_edge_preorder_intervals(gene_tree);
+		gene_tree->preorder_number();
+		gene_tree->edge_preorder_interval();
+		lca->build(gene_tree);
+	}
+
+	// edge_preorder_interval only widens the intervals it finds
+	static void clear_edge_preorder_intervals(Node *n) {
+		n->set_edge_pre_start(-1);
+		n->set_edge_pre_end(-1);
+		list<Node *>::const_iterator c;
+		for(c = n->get_children().begin(); c != n->get_children().end(); c++)
+			clear_edge_preorder_intervals(*c);
+	}
+
+	public:
+	GeneTreeIndex() {
+		taxa = unordered_map<Node *, vector<bool> >();
+	}
+
+	GeneTreeIndex(vector<Node *> &gene_trees) {
+		taxa = unordered_map<Node *, vector<bool> >();
+		add(gene_trees);
+	}
+
+	void add(Node *gene_tree) {
+		vector<bool> &leaf_numbers = taxa[gene_tree];
+		leaf_numbers.clear();
+		vector<Node *> leaves = gene_tree->find_leaves();
+		for(int i = 0; i < leaves.size(); i++) {
+			int number = stomini(leaves[i]->str());
+			if (number == INT_MAX)
+				continue;
+			if (number >= leaf_numbers.size())
+				leaf_numbers.resize(number + 1, false);
+			leaf_numbers[number] = true;
+		}
+		number(gene_tree, &lcas[gene_tree]);
+	}
+
+	void add(vector<Node *> &gene_trees) {
+		for(int i = 0; i < gene_trees.size(); i++)
+			add(gene_trees[i]);
+	}
+
+	/* renumber an indexed gene tree and rebuild its LCA tables after it
+		 was rerooted. Different gene trees can be updated in parallel
+	*/
+	void update(Node *gene_tree) {
+		unordered_map<Node *, LCA>::iterator l = lcas.find(gene_tree);
+		if (l != lcas.end())
+			number(gene_tree, &l->second);
+	}
+
+	void clear() {
+		taxa.clear();
+		lcas.clear();
+	}
+
+	bool contains(Node *gene_tree) {
+		return taxa.find(gene_tree) != taxa.end();
+	}
+
+	// the LCA tables of an indexed gene tree, or NULL
+	const LCA *lca(Node *gene_tree) {
+		unordered_map<Node *, LCA>::const_iterator l = lcas.find(gene_tree);
+		if (l == lcas.end())
+			return NULL;
+		return &l->second;
+	}
+
+	/* a copy of T restricted to the leaves of an indexed gene tree, or
+		 NULL if they share no leaves
+	*/
+	Node *restricted_copy(Node *T, Node *gene_tree) {
+		Node *copy = T->restricted_copy(taxa.find(gene_tree)->second);
+		if (copy != NULL) {
+			copy->set_depth(T->get_depth());
+			copy->fix_depths();
+		}
+		return copy;
+	}
+};
+
+#endif
@@ -0,0 +1,223 @@
+/*******************************************************************************
+LCA.cpp
+
+Data structure for LCA computations on a binary tree
+Implementation of the RMQ-based methods of Bender and Farach-Colton
+
+Copyright 2010-2014 Chris Whidden
+cwhidden@dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include "LCA.h"
+
+LCA &LCA::operator=(const LCA &other) {
+	tree = other.tree;
+	data = other.data;
+	N = other.N;
+	E = other.E;
+	H = other.H;
+	T = other.T;
+	P = other.P;
+	S = other.S;
+	B = other.B;
+	num_nodes = other.num_nodes;
+	euler_size = other.euler_size;
+	num_blocks = other.num_blocks;
+	num_levels = other.num_levels;
+	if (other.tables == other.data.data())
+		tables = data.data();
+	else
+		tables = other.tables;
+	return *this;
+}
+
+void LCA::build(Node *tree) {
+	this->tree = tree;
+	if (tree->get_preorder_number() == -1)
+		tree->preorder_number();
+	num_nodes = 0;
+	int max_preorder_number = -1;
+	measure(tree, &max_preorder_number);
+	euler_size = 2 * num_nodes - 1;
+	num_blocks = (euler_size + LCA_BLOCK_SIZE - 1) >> LCA_BLOCK_BITS;
+	num_levels = mylog2(num_blocks) + 1;
+	E = 0;
+	H = E + euler_size;
+	T = H + num_nodes;
+	P = T + max_preorder_number + 1;
+	S = P + euler_size;
+	B = S + euler_size;
+	data.resize(B + num_levels * num_blocks);
+	fill(data.begin() + T, data.begin() + P, -1);
+	N.resize(num_nodes);
+	int preorder_number = 0;
+	int euler_number = 0;
+	euler_tour(tree, &preorder_number, &euler_number);
+	precompute_rmq();
+	tables = data.data();
+}
+
+bool LCA::share(const LCA &pattern, Node *tree) {
+	if (pattern.tables == NULL)
+		return false;
+	this->tree = tree;
+	num_nodes = pattern.num_nodes;
+	euler_size = pattern.euler_size;
+	num_blocks = pattern.num_blocks;
+	num_levels = pattern.num_levels;
+	E = pattern.E;
+	H = pattern.H;
+	T = pattern.T;
+	P = pattern.P;
+	S = pattern.S;
+	B = pattern.B;
+	tables = pattern.tables;
+	N.assign(num_nodes, NULL);
+	if (!map_nodes(tree)) {
+		clear();
+		return false;
+	}
+	for(int i = 0; i < num_nodes; i++) {
+		if (N[i] == NULL)
+			N[i] = tree;
+	}
+	return true;
+}
+
+bool LCA::map_nodes(Node *node) {
+	int preorder_number = node->get_preorder_number();
+	if (preorder_number < 0 || preorder_number >= P - T)
+		return false;
+	int i = tables[T + preorder_number];
+	if (i < 0 || N[i] != NULL)
+		return false;
+	N[i] = node;
+	list<Node *>::const_iterator c;
+	for(c = node->get_children().begin(); c != node->get_children().end();
+			c++) {
+		if (!map_nodes(*c))
+			return false;
+	}
+	return true;
+}
+
+void LCA::measure(Node *node, int *max_preorder_number) {
+	num_nodes++;
+	if (node->get_preorder_number() > *max_preorder_number)
+		*max_preorder_number = node->get_preorder_number();
+	list<Node *>::const_iterator c;
+	for(c = node->get_children().begin(); c != node->get_children().end();
+			c++)
+		measure(*c, max_preorder_number);
+}
+
+void LCA::euler_tour(Node *node, int *next_preorder_number,
+		int *next_euler_number) {
+	// First visit
+	int preorder_number = (*next_preorder_number)++;
+	N[preorder_number] = node;
+	data[T + node->get_preorder_number()] = preorder_number;
+	data[H + preorder_number] = *next_euler_number;
+	data[E + (*next_euler_number)++] = preorder_number;
+
+	list<Node *>::const_iterator c;
+	for(c = node->get_children().begin(); c != node->get_children().end();
+			c++) {
+		euler_tour(*c, next_preorder_number, next_euler_number);
+		// Middle/Last visit
+		data[E + (*next_euler_number)++] = preorder_number;
+	}
+}
+
+void LCA::precompute_rmq() {
+	int *e = &data[E];
+	int *p = &data[P];
+	int *s = &data[S];
+	int *b = &data[B];
+	for(int block = 0; block < num_blocks; block++) {
+		int start = block << LCA_BLOCK_BITS;
+		int end = min(start + LCA_BLOCK_SIZE, euler_size);
+		int m = e[start];
+		for(int i = start; i < end; i++) {
+			m = min(m, e[i]);
+			p[i] = m;
+		}
+		m = e[end-1];
+		for(int i = end - 1; i >= start; i--) {
+			m = min(m, e[i]);
+			s[i] = m;
+		}
+		b[block] = m;
+	}
+	for(int level = 1; level < num_levels; level++) {
+		int *prev = b + (level - 1) * num_blocks;
+		int *row = b + level * num_blocks;
+		int half = 1 << (level - 1);
+		for(int block = 0; block + (1 << level) <= num_blocks; block++)
+			row[block] = min(prev[block], prev[block + half]);
+	}
+}
+
+void LCA::get_lcas(const vector<pair<int, int> > &ranges,
+		vector<Node *> *lcas) {
+	lcas->resize(ranges.size());
+	if (ranges.size() < 2 * LCA_BLOCK_SIZE) {
+		for(int q = 0; q < ranges.size(); q++)
+			(*lcas)[q] = N[rmq(ranges[q].first, ranges[q].second)];
+		return;
+	}
+	// counting sort of the queries by start block
+	vector<int> &start = batch_start;
+	vector<int> &order = batch_order;
+	start.assign(num_blocks + 1, 0);
+	order.resize(ranges.size());
+	for(int q = 0; q < ranges.size(); q++)
+		start[(ranges[q].first >> LCA_BLOCK_BITS) + 1]++;
+	for(int block = 0; block < num_blocks; block++)
+		start[block + 1] += start[block];
+	for(int q = 0; q < ranges.size(); q++)
+		order[start[ranges[q].first >> LCA_BLOCK_BITS]++] = q;
+	for(int i = 0; i < order.size(); i++) {
+		int q = order[i];
+		(*lcas)[q] = N[rmq(ranges[q].first, ranges[q].second)];
+	}
+}
+
+void LCA::debug() {
+	for(int i = 0; i < euler_size; i++) {
+		cout << " " << tables[E + i];
+	}
+	cout << endl;
+	cout << endl;
+	for(int i = 0; i < num_nodes; i++) {
+		cout << " " << tables[H + i];
+	}
+	cout << endl;
+	cout << endl;
+	cout << endl;
+	for(int level = 0; level < num_levels; level++) {
+		for(int block = 0; block + (1 << level) <= num_blocks; block++) {
+		cout << " " << tables[B + level * num_blocks + block];
+		}
+		cout << endl;
+		cout << endl;
+	}
+}
@@ -34,10 +34,12 @@ along with rspr.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include "Node.h"
 #include <vector>
+#include <utility>
 #include <cmath>
+#include <algorithm>
 using namespace std;
 
-int mylog2 (int val) {
+inline int mylog2 (int val) {
 	if (val <= 0)
 		return -1;
 	return 31 - __builtin_clz(val);
@@ -54,135 +56,147 @@ int mylog2 (int val) {
     return ret;
 }
 
+/* Euler tour positions are grouped in blocks of LCA_BLOCK_SIZE. A query
+	 inside one block is a short scan, otherwise it combines the block
+	 suffix and prefix minima at its ends with a sparse table over the
+	 minima of the blocks in between. This needs O(n) space in total.
+*/
+#define LCA_BLOCK_BITS 5
+#define LCA_BLOCK_SIZE (1 << LCA_BLOCK_BITS)
+
 class LCA {
 	private:
 	Node *tree;
-	vector<int> E;		// preorder numbers of euler tour
-	vector<int> L;		// levels of euler tour
-	vector<int> H;		// first occurence of a preorder number in E
-	vector<int> T;    // real preorder to internal preorder mapping
+	/* all of the tables are kept in one buffer, each at an offset:
+		E	preorder numbers of euler tour
+		H	first occurence of a preorder number in E
+		T	real preorder to internal preorder mapping
+		P	minimum of E from the start of its block
+		S	minimum of E to the end of its block
+		B	minimum of each run of 2^l blocks, one row for each l
+	*/
+	vector<int> data;
+	// the tables that are queried, data or those of another LCA
+	const int *tables;
 	vector<Node *> N;	// preorder to node mapping
-	vector<vector<int> > RMQ;	// precomputed RMQ values
+	// scratch space of get_lcas
+	vector<int> batch_start;
+	vector<int> batch_order;
+	int E, H, T, P, S, B;
+	int num_nodes;
+	int euler_size;
+	int num_blocks;
+	int num_levels;
 
 	public:
 	LCA(Node *tree) {
-		this->tree = tree;
-		T = vector<int>();
-		if (tree->get_preorder_number() == -1)
-			tree->preorder_number();
-		euler_tour(tree, 0);
-		precompute_rmq();
+		build(tree);
 	}
 
 	LCA() {
 		this->tree = NULL;
+		num_nodes = 0;
+		euler_size = 0;
+		num_blocks = 0;
+		num_levels = 0;
+		E = H = T = P = S = B = 0;
+		tables = NULL;
 	}
-	void euler_tour(Node *node, int depth) {
-		// First visit
-		int preorder_number = N.size();
-		int euler_number = E.size();
-		N.push_back(node);
-		if (T.size() <= node->get_preorder_number())
-			T.resize(node->get_preorder_number()+1,-1);
-		T[node->get_preorder_number()] = preorder_number;
-
-		//cout << preorder_number << "\t";
-		//node->print_subtree();
-		H.push_back(euler_number);
-		L.push_back(depth);
-		E.push_back(preorder_number);
-
-		// TODO: check that this is correct for multifurcating trees
-		
-		list<Node *>::const_iterator c;
-		for(c = node->get_children().begin(); c != node->get_children().end();
-				c++) {
-			euler_tour(*c, depth+1);
-			// Middle/Last visit
-			L.push_back(depth);
-			E.push_back(preorder_number);
-		}
 
+	LCA(const LCA &other) {
+		*this = other;
 	}
 
-	void precompute_rmq() {
-		// E gives queries of length 1
-		RMQ.push_back(E);
-		for(int length = 1; length < E.size(); length *= 2) {
-			vector<int> V = vector<int>();
-			for(int start = 0; start < E.size() - length; start++) {
-				V.push_back(rmq(start, start + length));
-			}
-			RMQ.push_back(V);
-		}
-	}
-	//vector<vector<int> > RMQ;	// precomputed RMQ values
+	// a copy queries its own tables, unless other shares those of another
+	LCA &operator=(const LCA &other);
+
+	/* (re)build the tables for tree, reusing the storage of any
+		 previous tree
+	*/
+	void build(Node *tree);
+
+	/* answer queries on tree with the tables of pattern, which must
+		 outlive them. tree is a copy of the tree of pattern that keeps its
+		 preorder numbers but may have lost nodes since, by deleting leaves,
+		 contracting nodes with one child or contracting sibling pairs. The
+		 lca of the nodes that are left is the same in both trees, or a
+		 node merged into the root when it was contracted, so the nodes
+		 that are gone stand for the root. Returns false if a node of tree
+		 is numbered differently, then build must be used instead
+	*/
+	bool share(const LCA &pattern, Node *tree);
 
-	// find the index of the rmq between indices i and j of E
+	bool map_nodes(Node *node);
+
+	void measure(Node *node, int *max_preorder_number);
+
+	void euler_tour(Node *node, int *next_preorder_number,
+			int *next_euler_number);
+
+	void precompute_rmq();
+
+	// find the rmq between indices i <= j of E
 	int rmq(int i, int j) {
-		if (i == j)
-			return E[i];
-		int length = j - i - 1;
-		//cout << "  " << i << " " << j << endl;
-		//cout << "  " << length << endl;
-		//cout << "  " << mylog2(length) << endl;
-		length = (mylog2(length));
-		//cout << "  " << length << endl;
-		//cout << "  " << j - (1 << (length)) << endl;
-		int rmq1 = RMQ[length+1][i];
-		int rmq2;
-		if (length >= 0)
-			rmq2 = RMQ[length+1][j - (1 << (length))];
-		else
-			rmq2 = RMQ[length+1][j];
-		if (rmq1 < rmq2)
-			return rmq1;
-		return rmq2;
+		const int *e = tables + E;
+		int block_i = i >> LCA_BLOCK_BITS;
+		int block_j = j >> LCA_BLOCK_BITS;
+		if (block_i == block_j) {
+			int m = e[i];
+			for(int k = i + 1; k <= j; k++)
+				m = min(m, e[k]);
+			return m;
+		}
+		int m = min(tables[S + i], tables[P + j]);
+		if (block_j - block_i > 1) {
+			int level = mylog2(block_j - block_i - 1);
+			const int *row = tables + B + level * num_blocks;
+			m = min(m, min(row[block_i + 1], row[block_j - (1 << level)]));
+		}
+		return m;
 	}
+
 	Node *get_lca(Node *a, Node *b) {
-		int preorder_a = T[a->get_preorder_number()];
-		int preorder_b = T[b->get_preorder_number()];
-		int lca_index;
-		if (preorder_a <= preorder_b)
-			lca_index = rmq(H[preorder_a], H[preorder_b]);
-		else
-			lca_index = rmq(H[preorder_b], H[preorder_a]);
-		return N[lca_index];
+		int first_a = tables[H + tables[T + a->get_preorder_number()]];
+		int first_b = tables[H + tables[T + b->get_preorder_number()]];
+		if (first_a <= first_b)
+			return N[rmq(first_a, first_b)];
+		return N[rmq(first_b, first_a)];
+	}
+
+	// position of the first visit to a in the Euler tour
+	int first_visit(Node *a) {
+		return tables[H + tables[T + a->get_preorder_number()]];
 	}
 
+	/* answer a batch of queries, each a range i <= j of Euler tour
+		 positions, with the lca of all nodes visited in it. The lca of a
+		 set of nodes is that of the range between their first and last
+		 first_visit. The queries are bucketed by the block they start in,
+		 so the tables are read in one pass from the start of the tour.
+		 lcas[q] is the answer to ranges[q]
+	*/
+	void get_lcas(const vector<pair<int, int> > &ranges,
+			vector<Node *> *lcas);
+
 	Node *get_tree() {
 		return tree;
 	}
 
-	/* copy constructor
-	LCA(const LCA &n) {
-	}
+	/* forget the tree, so no pointers into it are kept once it is
+		 deleted. The storage is kept for the next build
 	*/
-	void debug() {
-		for(int i = 0; i < E.size(); i++) {
-			cout << " " << E[i];
-		}
-		cout << endl;
-		cout << endl;
-		for(int i = 0; i < L.size(); i++) {
-			cout << " " << L[i];
-		}
-		cout << endl;
-		cout << endl;
-		for(int i = 0; i < H.size(); i++) {
-			cout << " " << H[i];
-		}
-		cout << endl;
-		cout << endl;
-		cout << endl;
-		for(int i = 0; i < RMQ.size(); i++) {
-			for(int j = 0; j < RMQ[i].size(); j++) {
-			cout << " " << RMQ[i][j];
-			}
-			cout << endl;
-			cout << endl;
-		}
+	void clear() {
+		tree = NULL;
+		data.clear();
+		tables = NULL;
+		N.clear();
+		num_nodes = 0;
+		euler_size = 0;
+		num_blocks = 0;
+		num_levels = 0;
 	}
+
+	void debug();
 };
 
 #endif
@@ -0,0 +1,261 @@
+/*******************************************************************************
+Node.cpp
+
+Data structure for a node of a binary tree
+Contains methods to recursively work on a node's subtree
+
+Copyright 2009-2014 Chris Whidden
+cwhidden@dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include "Node.h"
+
+bool IGNORE_MULTI = false;
+
+double REQUIRED_SUPPORT = 0.0;
+
+// build a tree from a newick string
+Node *build_tree(string s) {
+	return build_tree(s, 0, NULL);
+}
+
+Node *build_tree(string s, int start_depth) {
+	return build_tree(s, start_depth, NULL);
+}
+
+Node *build_tree(string s, set<string, StringCompare> *include_only) {
+	return build_tree(s, 0, include_only);
+}
+
+Node *build_tree(string s, int start_depth, set<string, StringCompare> *include_only) {
+	if (s == "")
+		return new Node();
+	Node *dummy_head = new Node("p", start_depth-1);
+	bool valid = true;
+	build_tree_helper(0, s, dummy_head, valid, include_only);
+	Node *head = dummy_head->lchild();
+	if (valid && head != NULL) {
+		delete dummy_head;
+		return head;
+	}
+	else {
+		if (head != NULL)
+			head->delete_tree();
+		return dummy_head;
+	}
+
+}
+
+// build_tree recursive helper function
+int build_tree_helper(int start, const string& s, Node *parent,
+		bool &valid, set<string, StringCompare> *include_only) {
+	int loc = s.find_first_of("(,)", start);
+	if (loc == string::npos) {
+		string name = s.substr(start, s.size() - start);
+		int name_end = name.find(':');
+		if (name_end != string::npos)
+			name = name.substr(0, name_end);
+		if (include_only == NULL ||
+				include_only->find(name) != include_only->end()) {
+			Node *node = new Node(name);
+			parent->add_child(node);
+		}
+		loc = s.size()-1;
+		return loc;
+	}
+	while(s[start] == ' ' || s[start] == '\t')
+		start++;
+	int end = loc;
+	while(s[end] == ' ' || s[end] == '\t')
+		end--;
+	string name = s.substr(start, end - start);
+	int name_end = name.find(':');
+	if (name_end != string::npos)
+		name = name.substr(0, name_end);
+	Node *node = NULL;
+	if (include_only == NULL ||
+			include_only->find(name) != include_only->end()) {
+		node = new Node(name);
+		parent->add_child(node);
+	}
+
+	int count = 1;
+	if (s[loc] == '(') {
+			loc = build_tree_helper(loc + 1, s, node, valid, include_only);
+			while(s[loc] == ',') {
+				loc = build_tree_helper(loc + 1, s, node, valid, include_only);
+				count++;
+			}
+//			int loc_check = s.find_first_of("(,)", loc);
+//			if (loc_check != string::npos &&
+//					s[loc_check] == ','
+			if (s[loc] != ')'
+					|| IGNORE_MULTI && count > 2) {
+				valid = false;
+					return s.size()-1;
+			}
+			// TODO: get the support values here (and branch lengths?)
+			// contract_node() if support is less than a threshold
+			loc++;
+			if (s[loc-1] == ')') {
+				int numc = node->get_children().size();
+				bool contracted = false;
+				int next = s.find_first_of(",)", loc);
+				if (next != string::npos) {
+					if (next > loc && REQUIRED_SUPPORT > 0) {
+						string info = s.substr(loc, next - loc);
+						if (info[0] != ':') {
+							double support = atof(info.c_str());
+//							cout << "support=" << support << endl;
+							if (support < REQUIRED_SUPPORT && numc > 0) {
+								node->contract_node();
+								contracted = true;
+							}
+						}
+					}
+					loc=next;
+				}
+				if (!contracted) {
+					if (numc == 1)
+						node->contract_node();
+					else if (numc == 0 && name == "") {
+						node->cut_parent();
+						delete node;
+					}
+				}
+			}
+	}
+	return loc;
+}
+
+void swap(Node **a, Node **b) {
+	Node *temp = *a;
+	*a = *b;
+	*b = temp;
+}
+
+/*
+void preorder_number(Node *node) {
+	preorder_number(node, 0);
+}
+int preorder_number(Node *node, int next) {
+	node->set_preorder_number(next);
+	next++;
+	if(node->lchild() != NULL) {
+		next = preorder_number(node->lchild(), next);
+	}
+	if(node->rchild() != NULL) {
+		next = preorder_number(node->rchild(), next);
+	}
+	return next;
+}
+*/
+// return the smallest number in s
+
+int stomini(string s) {
+//	cout << "stomini" << endl;
+	string number_characters = "+-0123456789";
+	int i = 0;
+	int min = INT_MAX;
+	string current = "";
+	for(int i = 0; i < s.size(); i++) {
+		if (number_characters.find(s[i]) != string::npos) {
+			current += s[i];
+		}
+		else if (current.size() > 0) {
+			int num = atoi(current.c_str());
+			if (num < min)
+				min = num;
+			current = "";
+		}
+	}
+	if (current.size() > 0) {
+		int num = atoi(current.c_str());
+		if (num < min)
+			min = num;
+		current = "";
+	}
+//	cout << "returning " << min << endl;
+	return min;
+}
+
+string root(string s) {
+//	cout << "root(string s)" << endl;
+//	cout << s << endl;
+	string r = "";
+	int i = 0;
+	int depth = 0;
+	int first_c = -1;
+	int second_c = -1;
+	int last_bracket = -1;
+	for(int i = 0; i < s.size(); i++) {
+		if (s[i] == '(')
+			depth++;
+		else if (s[i] == ')') {
+			depth--;
+			last_bracket = i;
+		}
+		else if (depth == 1 && s[i] == ',') {
+			if (first_c == -1)
+				first_c = i;
+			else if  (second_c == -1)
+				second_c = i;
+		}
+	}
+	if (second_c == -1 || last_bracket == -1)
+		return s;
+	else {
+		r.append(s.substr(0,first_c+1));
+		r.append("(");
+		r.append(s.substr(first_c+1,last_bracket-first_c));
+		r.append(")");
+		r.append(s.substr(last_bracket+1,string::npos));
+	}
+//	cout << r << endl;
+	return r;
+}
+
+string strip_newick_name(string &line) {
+	string name;
+	size_t loc = line.find_first_of("(");
+	if (loc != string::npos) {
+		name = "";
+		if (loc != 0) {
+			name = line.substr(0,loc);
+			line.erase(0,loc);
+		}
+	}
+	return name;
+}
+
+void reroot_safe(Node **n, Node *new_lc) {
+	(*n)->reroot(new_lc);
+	(*n)->set_depth(0);
+	(*n)->fix_depths();
+	(*n)->preorder_number();
+	(*n)->edge_preorder_interval();
+	// hack TODO fix
+	string str = (*n)->str_subtree();
+	(*n)->delete_tree();
+	(*n) = build_tree(str);
+	(*n)->preorder_number();
+	(*n)->edge_preorder_interval();
+}
@@ -39,12 +39,15 @@ along with rspr.  If not, see <http://www.gnu.org/licenses/>.
 #include <sstream>
 #include <map>
 #include <set>
-#include "Forest.h"
+#include <list>
+#include <vector>
+#include <climits>
+#include <cstring>
 
 using namespace std;
 
-bool IGNORE_MULTI = false;
-double REQUIRED_SUPPORT = 0.0;
+extern bool IGNORE_MULTI;
+extern double REQUIRED_SUPPORT;
 
 struct StringCompare {
 	bool operator() (const string &a, const string &b) const {
@@ -174,11 +177,11 @@ class Node {
 		if (n.contracted_lc == NULL)
 			contracted_lc = NULL;
 		else
-			contracted_lc = new Node(*(n.contracted_lc), this);
+			contracted_lc = new Node(*(n.contracted_lc));
 		if (n.contracted_rc == NULL)
 			contracted_rc = NULL;
 		else
-			contracted_rc = new Node(*(n.contracted_rc), this);
+			contracted_rc = new Node(*(n.contracted_rc));
 		this->contracted = n.contracted;
 #else
 		this->contracted_lc = n.contracted_lc;
@@ -223,11 +226,11 @@ class Node {
 		if (n.contracted_lc == NULL)
 			contracted_lc = NULL;
 		else
-			contracted_lc = new Node(*(n.contracted_lc), this);
+			contracted_lc = new Node(*(n.contracted_lc));
 		if (n.contracted_rc == NULL)
 			contracted_rc = NULL;
 		else
-			contracted_rc = new Node(*(n.contracted_rc), this);
+			contracted_rc = new Node(*(n.contracted_rc));
 		this->contracted = n.contracted;
 #else
 		this->contracted_lc = n.contracted_lc;
@@ -241,6 +244,63 @@ class Node {
 		this->support = n.support;
 		this->support_normalization = n.support_normalization;
 	}
+
+	/* copy of the subtree restricted to the unlabelled leaves and the
+		 leaves with a number in taxa, or NULL if there are none. Nodes
+		 left with one child are contracted as sync_twins would. Depths
+		 are only fixed by the caller
+	*/
+	Node *restricted_copy(vector<bool> &taxa) {
+		if (children.empty()) {
+			int number = stomini(name);
+			if (number < INT_MAX && (number >= taxa.size() || !taxa[number]))
+				return NULL;
+			return new Node(*this);
+		}
+		list<Node *> kept = list<Node *>();
+		list<Node *>::iterator c;
+		for(c = children.begin(); c != children.end(); c++) {
+			Node *child = (*c)->restricted_copy(taxa);
+			if (child != NULL)
+				kept.push_back(child);
+		}
+		if (kept.empty())
+			return NULL;
+		if (kept.size() == 1) {
+			Node *child = kept.front();
+			if (children.size() > 1)
+				child->lost_child();
+			child->copy_edge_pre_interval(this);
+			if (edge_protected && !child->is_protected())
+				child->protect_edge();
+			return child;
+		}
+		Node *copy = new Node(name, depth);
+		copy->twin = twin;
+		copy->pre_num = pre_num;
+		copy->edge_pre_start = edge_pre_start;
+		copy->edge_pre_end = edge_pre_end;
+		copy->component_number = component_number;
+#ifdef COPY_CONTRACTED
+		if (contracted_lc != NULL)
+			copy->contracted_lc = new Node(*contracted_lc, copy);
+		if (contracted_rc != NULL)
+			copy->contracted_rc = new Node(*contracted_rc, copy);
+#else
+		copy->contracted_lc = contracted_lc;
+		copy->contracted_rc = contracted_rc;
+#endif
+		copy->contracted = contracted;
+		copy->edge_protected = edge_protected;
+		copy->allow_sibling = allow_sibling;
+		copy->lost_children = lost_children;
+		copy->max_merge_depth = max_merge_depth;
+		copy->support = support;
+		copy->support_normalization = support_normalization;
+		for(c = kept.begin(); c != kept.end(); c++)
+			copy->add_child(*c);
+		return copy;
+	}
 	// TODO: clear_parent function
 	~Node() {
 		list<Node *>::iterator c = children.begin();
@@ -409,6 +469,7 @@ class Node {
 	}
 	Node *set_name(string n) {
 		name = string(n);
+		return this;
 	}
 	int set_depth(int d) {
 		depth = d;
@@ -447,6 +508,7 @@ class Node {
 
 	int set_component_number(int c) {
 		component_number = c;
+		return component_number;
 	}
 	list<Node *>& get_children() {
 		return children;
@@ -460,9 +522,11 @@ class Node {
 
 	Node *set_contracted_lc(Node *n) {
 		contracted_lc = n;
+		return contracted_lc;
 	}
 	Node *set_contracted_rc(Node *n) {
 		contracted_rc = n;
+		return contracted_rc;
 	}
 
 
@@ -578,28 +642,34 @@ class Node {
 	}
 	double set_support(double s) {
 		support = s;
+		return support;
 	}
 	double a_inc_support() {
 #pragma omp atomic
 		support += 1;
+		return support;
 	}
 	double a_dec_support() {
 #pragma omp atomic
 		support -= 1;
+		return support;
 	}
 	double get_support_normalization() {
 		return support_normalization;
 	}
 	double set_support_normalization(double s) {
 		support_normalization = s;
+		return support_normalization;
 	}
 	double a_inc_support_normalization() {
 #pragma omp atomic
 		support_normalization += 1;
+		return support_normalization;
 	}
 	double a_dec_support_normalization() {
 #pragma omp atomic
 		support_normalization -= 1;
+		return support_normalization;
 	}
 
 	void normalize_support() {
@@ -622,6 +692,7 @@ class Node {
 	}
 	int set_num_clustered_children(int c) {
 		num_clustered_children = c;
+		return num_clustered_children;
 	}
 	int get_num_clustered_children() {
 		return num_clustered_children;
@@ -637,6 +708,7 @@ class Node {
 	}
 	int set_sibling_pair_status(int s){
 		sibling_pair_status = s;
+		return sibling_pair_status;
 	}
 	void set_forest(Forest *f) {
 		forest = f;
@@ -1964,7 +2036,7 @@ Node *spr(Node *new_sibling, int &which_child) {
 
 Node *spr(Node *new_sibling) {
 	int na = 0;
-	spr(new_sibling, na);
+	return spr(new_sibling, na);
 }
 
 void find_descendant_counts_hlpr(vector<int> *dc) {
@@ -2202,207 +2274,11 @@ int build_tree_helper(int start, const string& s, Node *parent,
 //int preorder_number(Node *node, int next);
 string strip_newick_name(string &T);
 
-
-// build a tree from a newick string
-Node *build_tree(string s) {
-	return build_tree(s, 0, NULL);
-}
-Node *build_tree(string s, int start_depth) {
-	return build_tree(s, start_depth, NULL);
-}
-Node *build_tree(string s, set<string, StringCompare> *include_only) {
-	return build_tree(s, 0, include_only);
-}
-Node *build_tree(string s, int start_depth, set<string, StringCompare> *include_only) {
-	if (s == "")
-		return new Node();
-	Node *dummy_head = new Node("p", start_depth-1);
-	bool valid = true;
-	build_tree_helper(0, s, dummy_head, valid, include_only);
-	Node *head = dummy_head->lchild();
-	if (valid && head != NULL) {
-		delete dummy_head;
-		return head;
-	}
-	else {
-		if (head != NULL)
-			head->delete_tree();
-		return dummy_head;
-	}
-
-}
-
-// build_tree recursive helper function
-int build_tree_helper(int start, const string& s, Node *parent,
-		bool &valid, set<string, StringCompare> *include_only) {
-	int loc = s.find_first_of("(,)", start);
-	if (loc == string::npos) {
-		string name = s.substr(start, s.size() - start);
-		int name_end = name.find(':');
-		if (name_end != string::npos)
-			name = name.substr(0, name_end);
-		if (include_only == NULL ||
-				include_only->find(name) != include_only->end()) {
-			Node *node = new Node(name);
-			parent->add_child(node);
-		}
-		loc = s.size()-1;
-		return loc;
-	}
-	while(s[start] == ' ' || s[start] == '\t')
-		start++;
-	int end = loc;
-	while(s[end] == ' ' || s[end] == '\t')
-		end--;
-	string name = s.substr(start, end - start);
-	int name_end = name.find(':');
-	if (name_end != string::npos)
-		name = name.substr(0, name_end);
-	Node *node = NULL;
-	if (include_only == NULL ||
-			include_only->find(name) != include_only->end()) {
-		node = new Node(name);
-		parent->add_child(node);
-	}
-
-	int count = 1;
-	if (s[loc] == '(') {
-			loc = build_tree_helper(loc + 1, s, node, valid, include_only);
-			while(s[loc] == ',') {
-				loc = build_tree_helper(loc + 1, s, node, valid, include_only);
-				count++;
-			}
-//			int loc_check = s.find_first_of("(,)", loc);
-//			if (loc_check != string::npos &&
-//					s[loc_check] == ','
-			if (s[loc] != ')'
-					|| IGNORE_MULTI && count > 2) {
-				valid = false;
-					return s.size()-1;
-			}
-			// TODO: get the support values here (and branch lengths?)
-			// contract_node() if support is less than a threshold
-			loc++;
-			if (s[loc-1] == ')') {
-				int numc = node->get_children().size();
-				bool contracted = false;
-				int next = s.find_first_of(",)", loc);
-				if (next != string::npos) {
-					if (next > loc && REQUIRED_SUPPORT > 0) {
-						string info = s.substr(loc, next - loc);
-						if (info[0] != ':') {
-							double support = atof(info.c_str());
-//							cout << "support=" << support << endl;
-							if (support < REQUIRED_SUPPORT && numc > 0) {
-								node->contract_node();
-								contracted = true;
-							}
-						}
-					}
-					loc=next;
-				}
-				if (!contracted) {
-					if (numc == 1)
-						node->contract_node();
-					else if (numc == 0 && name == "") {
-						node->cut_parent();
-						delete node;
-					}
-				}
-			}
-	}
-	return loc;
-}
-
 // swap two nodes
-void swap(Node **a, Node **b) {
-	Node *temp = *a;
-	*a = *b;
-	*b = temp;
-}
-
-
-/*
-void preorder_number(Node *node) {
-	preorder_number(node, 0);
-}
-int preorder_number(Node *node, int next) {
-	node->set_preorder_number(next);
-	next++;
-	if(node->lchild() != NULL) {
-		next = preorder_number(node->lchild(), next);
-	}
-	if(node->rchild() != NULL) {
-		next = preorder_number(node->rchild(), next);
-	}
-	return next;
-}
-*/
-// return the smallest number in s
-
-int stomini(string s) {
-//	cout << "stomini" << endl;
-	string number_characters = "+-0123456789";
-	int i = 0;
-	int min = INT_MAX;
-	string current = "";
-	for(int i = 0; i < s.size(); i++) {
-		if (number_characters.find(s[i]) != string::npos) {
-			current += s[i];
-		}
-		else if (current.size() > 0) {
-			int num = atoi(current.c_str());
-			if (num < min)
-				min = num;
-			current = "";
-		}
-	}
-	if (current.size() > 0) {
-		int num = atoi(current.c_str());
-		if (num < min)
-			min = num;
-		current = "";
-	}
-//	cout << "returning " << min << endl;
-	return min;
-}
+void swap(Node **a, Node **b);
 
 // assumes that an unrooted tree is represented with a 3-way multifurcation
-string root(string s) {
-//	cout << "root(string s)" << endl;
-//	cout << s << endl;
-	string r = "";
-	int i = 0;
-	int depth = 0;
-	int first_c = -1;
-	int second_c = -1;
-	int last_bracket = -1;
-	for(int i = 0; i < s.size(); i++) {
-		if (s[i] == '(')
-			depth++;
-		else if (s[i] == ')') {
-			depth--;
-			last_bracket = i;
-		}
-		else if (depth == 1 && s[i] == ',') {
-			if (first_c == -1)
-				first_c = i;
-			else if  (second_c == -1)
-				second_c = i;
-		}
-	}
-	if (second_c == -1 || last_bracket == -1)
-		return s;
-	else {
-		r.append(s.substr(0,first_c+1));
-		r.append("(");
-		r.append(s.substr(first_c+1,last_bracket-first_c));
-		r.append(")");
-		r.append(s.substr(last_bracket+1,string::npos));
-	}
-//	cout << r << endl;
-	return r;
-}
+string root(string s);
 
 template <typename T> vector<T> &random_select(vector <T> &V, int n) {
 	vector<T> *ret = new vector<T>;
@@ -2428,36 +2304,9 @@ template <typename T> void print_vector(vector <T> V) {
 	cout << endl;
 }
 
-string strip_newick_name(string &line) {
-	string name;
-	size_t loc = line.find_first_of("(");
-	if (loc != string::npos) {
-		name = "";
-		if (loc != 0) {
-			name = line.substr(0,loc);
-			line.erase(0,loc);
-		}
-	}
-	return name;
-}
-
-void reroot_safe(Node **n, Node *new_lc) {
-	(*n)->reroot(new_lc);
-	(*n)->set_depth(0);
-	(*n)->fix_depths();
-	(*n)->preorder_number();
-	(*n)->edge_preorder_interval();
-	// hack TODO fix
-	string str = (*n)->str_subtree();
-	(*n)->delete_tree();
-	(*n) = build_tree(str);
-	(*n)->preorder_number();
-	(*n)->edge_preorder_interval();
-}
-
-
-
-
+void reroot_safe(Node **n, Node *new_lc);
 
+// Forest needs the complete Node
+#include "Forest.h"
 
 #endif
@@ -0,0 +1,45 @@
+/*******************************************************************************
+RsprContext.cpp
+
+Options, memo tables and statistics of the rSPR solver
+
+Copyright 2009-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#include "RsprContext.h"
+
+RsprContext *default_rspr_context() {
+	static RsprContext context;
+	return &context;
+}
+
+thread_local RsprContext *CURRENT_RSPR_CONTEXT = NULL;
+
+void print_rspr_stats(const string &file) {
+	if (file == "")
+		rspr_context()->stats.print_json(cerr);
+	else {
+		ofstream stats_file(file.c_str());
+		rspr_context()->stats.print_json(stats_file);
+	}
+}
@@ -0,0 +1,662 @@
+/*******************************************************************************
+RsprContext.h
+
+Options, memo tables and statistics of the rSPR solver
+
+Copyright 2009-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+#ifndef INCLUDE_RSPRCONTEXT
+#define INCLUDE_RSPRCONTEXT
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <time.h>
+
+using namespace std;
+
+/*
+	Every option and piece of mutable state of the solver lives in an
+	RsprContext. Each thread has a current context, the shared default
+	context unless another is installed with an RsprContextScope, and the
+	old global options (PREFER_RHO, MAX_SPR, MAIN_CALL, ...) are its fields.
+	The branch and bound, the 3-approximation and the clustering pass their
+	context down explicitly; other code reaches the current one through
+	rspr_context(). Independent distance queries can therefore run
+	concurrently, each under its own context.
+
+	Copies of a context copy its RsprOptions and share its memo table, a
+	ClusterMemo, but get their own statistics and call state. Parallel
+	drivers give each iteration an RsprContextCopy so that the options a
+	solve changes (PREFER_RHO, MIN_SPR, MAX_SPR, ...) stay private to it.
+*/
+
+// CLASSES
+
+class DistanceCache;
+class GeneTreeIndex;
+
+/* a memoized subproblem: a proven lower bound on its distance and,
+	 once one is found, an agreement forest pair of size k as forest
+	 strings
+*/
+class ProblemSolution {
+public:
+string T1;
+string T2;
+int k;
+int lower_bound;
+
+ProblemSolution() {
+	T1 = "";
+	T2 = "";
+	k = -1;
+	lower_bound = 0;
+}
+
+ProblemSolution(string t1, string t2, int new_k) {
+	T1 = t1;
+	T2 = t2;
+	k = new_k;
+	lower_bound = 0;
+}
+	};
+
+/* a bounded memo table of cluster subproblems, evicting the least
+	 recently used subproblem when full. Subproblems are found by a
+	 ClusterMemo::Key, a pair of canonical hashes of the two forests that
+	 does not depend on the order of children or components (see
+	 cluster_memo_key). Solutions are stored in a compact byte encoding of
+	 their forest strings. Safe to share between threads
+*/
+class ClusterMemo {
+	public:
+	struct Key {
+		unsigned long long h1;
+		unsigned long long h2;
+		bool operator==(const Key &k) const {
+			return h1 == k.h1 && h2 == k.h2;
+		}
+	};
+
+	private:
+	struct KeyHash {
+		size_t operator()(const Key &k) const {
+			return (size_t)(k.h1 ^ (k.h2 * 0x9e3779b97f4a7c15ULL));
+		}
+	};
+	// what is known about a subproblem, with the forests encoded
+	struct Entry {
+		string F1;
+		string F2;
+		int k;
+		int lower_bound;
+		Entry() {
+			k = -1;
+			lower_bound = 0;
+		}
+	};
+	typedef list<pair<Key, Entry> > Entries;
+
+	// most recently used first
+	Entries entries;
+	unordered_map<Key, Entries::iterator, KeyHash> index;
+	int capacity;
+
+	/* forest strings are made of leaf numbers, the rho leaf p and the
+		 separators "(),", and " " between components. Each becomes one
+		 varint: 0-4 for "(),p " and 5+x for the number x, so small numbers
+		 take one byte and no separator is needed between them. Any other
+		 string is kept as it is, after a 1 byte
+	*/
+	static void put_varint(unsigned int v, string *out) {
+		while (v >= 0x80) {
+			*out += (char)(0x80 | (v & 0x7f));
+			v >>= 7;
+		}
+		*out += (char)v;
+	}
+
+	static string encode(const string &s) {
+		static const string symbols = "(),p ";
+		string out = string(1, (char)0);
+		// trailing separator
+		int end = s.size();
+		if (end > 0 && s[end-1] == ' ')
+			end--;
+		for(int i = 0; i < end; i++) {
+			size_t symbol = symbols.find(s[i]);
+			if (symbol != string::npos) {
+				put_varint(symbol, &out);
+			}
+			else if (s[i] >= '0' && s[i] <= '9'
+					&& (s[i] != '0' || i+1 >= end || s[i+1] < '0' || s[i+1] > '9')) {
+				unsigned int x = 0;
+				for(; i < end && s[i] >= '0' && s[i] <= '9'; i++) {
+					x = x * 10 + (s[i] - '0');
+					if (x > 100000000)
+						return string(1, (char)1) + s.substr(0, end);
+				}
+				i--;
+				put_varint(x + 5, &out);
+			}
+			else {
+				return string(1, (char)1) + s.substr(0, end);
+			}
+		}
+		return out;
+	}
+
+	static string decode(const string &e) {
+		if (e.empty())
+			return "";
+		if (e[0] == 1)
+			return e.substr(1);
+		static const string symbols = "(),p ";
+		string out = "";
+		for(int i = 1; i < e.size(); ) {
+			unsigned int v = 0;
+			int shift = 0;
+			unsigned char b;
+			do {
+				b = (unsigned char)e[i++];
+				v |= (unsigned int)(b & 0x7f) << shift;
+				shift += 7;
+			} while ((b & 0x80) && i < e.size());
+			if (v < 5) {
+				out += symbols[v];
+			}
+			else {
+				stringstream ss;
+				ss << v - 5;
+				out += ss.str();
+			}
+		}
+		return out;
+	}
+
+	// the entry of k, created if needed, as the most recently used.
+	// Must be called in the rspr_memo critical section
+	Entry *touch(const Key &k) {
+		unordered_map<Key, Entries::iterator, KeyHash>::iterator i =
+				index.find(k);
+		if (i != index.end()) {
+			entries.splice(entries.begin(), entries, i->second);
+			return &(i->second->second);
+		}
+		entries.push_front(make_pair(k, Entry()));
+		index[k] = entries.begin();
+		if (entries.size() > capacity) {
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+		return &(entries.front().second);
+	}
+
+	public:
+	ClusterMemo(int capacity = 100000) {
+		this->capacity = capacity;
+	}
+
+	int size() {
+		int s;
+		#pragma omp critical(rspr_memo)
+		s = entries.size();
+		return s;
+	}
+
+	void set_capacity(int c) {
+		#pragma omp critical(rspr_memo)
+		{
+			capacity = c;
+			while (entries.size() > capacity && !entries.empty()) {
+				index.erase(entries.back().first);
+				entries.pop_back();
+			}
+		}
+	}
+
+	// find what is known about the subproblem k
+	bool find(const Key &k, ProblemSolution *solution) {
+		Entry e;
+		bool found = false;
+		#pragma omp critical(rspr_memo)
+		{
+			unordered_map<Key, Entries::iterator, KeyHash>::iterator i =
+					index.find(k);
+			if (i != index.end()) {
+				entries.splice(entries.begin(), entries, i->second);
+				e = i->second->second;
+				found = true;
+			}
+		}
+		if (found) {
+			solution->T1 = decode(e.F1);
+			solution->T2 = decode(e.F2);
+			solution->k = e.k;
+			solution->lower_bound = e.lower_bound;
+		}
+		return found;
+	}
+
+	// record that k has no agreement forest of size below lower_bound
+	void add_lower_bound(const Key &k, int lower_bound) {
+		if (capacity <= 0)
+			return;
+		#pragma omp critical(rspr_memo)
+		{
+			Entry *e = touch(k);
+			if (lower_bound > e->lower_bound)
+				e->lower_bound = lower_bound;
+		}
+	}
+
+	// record an agreement forest pair of k, keeping the smallest
+	void add_solution(const Key &k, const ProblemSolution &solution) {
+		if (capacity <= 0)
+			return;
+		string F1 = encode(solution.T1);
+		string F2 = encode(solution.T2);
+		#pragma omp critical(rspr_memo)
+		{
+			Entry *e = touch(k);
+			if (e->k < 0 || solution.k < e->k) {
+				e->F1 = F1;
+				e->F2 = F2;
+				e->k = solution.k;
+			}
+		}
+	}
+};
+
+// the phases timed by an RsprTimer
+enum RSPR_PHASE {PHASE_SYNC_TWINS, PHASE_APPROX, PHASE_BB, NUM_PHASES};
+
+/* counters for the solves run under a context. Counters that a forked
+	 branch-and-bound task can reach are updated atomically
+*/
+class RsprStats {
+	public:
+	long memo_hits;
+	long memo_misses;
+	long cluster_reductions;
+	long forked_tasks;
+	// branch-and-bound calls, in total and by the k of the search
+	long long bb_nodes;
+	vector<long long> bb_nodes_per_k;
+	// branches cut off by the 3-approximation lower bound
+	long approx_prunes;
+	long long undo_events;
+	int max_undo_depth;
+	// clusters solved by the simple clustering and their leaves
+	long clusters;
+	long long cluster_leaves;
+	int max_cluster_leaves;
+	// seconds spent in each phase, only when COLLECT_STATS is set
+	double phase_time[NUM_PHASES];
+	// nesting of the phase timers, so that only the outermost counts
+	int phase_depth[NUM_PHASES];
+	// nesting of branch-and-bound searches, so that only the outermost
+	// search counts its nodes by k
+	int bb_depth;
+
+	RsprStats() {
+		memo_hits = 0;
+		memo_misses = 0;
+		cluster_reductions = 0;
+		forked_tasks = 0;
+		bb_nodes = 0;
+		bb_nodes_per_k = vector<long long>();
+		approx_prunes = 0;
+		undo_events = 0;
+		max_undo_depth = 0;
+		clusters = 0;
+		cluster_leaves = 0;
+		max_cluster_leaves = 0;
+		for(int i = 0; i < NUM_PHASES; i++) {
+			phase_time[i] = 0;
+			phase_depth[i] = 0;
+		}
+		bb_depth = 0;
+	}
+
+	void add(const RsprStats &s) {
+		memo_hits += s.memo_hits;
+		memo_misses += s.memo_misses;
+		cluster_reductions += s.cluster_reductions;
+		forked_tasks += s.forked_tasks;
+		bb_nodes += s.bb_nodes;
+		if (bb_nodes_per_k.size() < s.bb_nodes_per_k.size())
+			bb_nodes_per_k.resize(s.bb_nodes_per_k.size(), 0);
+		for(int k = 0; k < s.bb_nodes_per_k.size(); k++)
+			bb_nodes_per_k[k] += s.bb_nodes_per_k[k];
+		approx_prunes += s.approx_prunes;
+		undo_events += s.undo_events;
+		if (s.max_undo_depth > max_undo_depth)
+			max_undo_depth = s.max_undo_depth;
+		clusters += s.clusters;
+		cluster_leaves += s.cluster_leaves;
+		if (s.max_cluster_leaves > max_cluster_leaves)
+			max_cluster_leaves = s.max_cluster_leaves;
+		for(int i = 0; i < NUM_PHASES; i++)
+			phase_time[i] += s.phase_time[i];
+	}
+
+	void add_bb_nodes(int k, long long nodes) {
+		if (k < 0)
+			return;
+		if (bb_nodes_per_k.size() <= k)
+			bb_nodes_per_k.resize(k + 1, 0);
+		bb_nodes_per_k[k] += nodes;
+	}
+
+	void add_undo(int events, int depth) {
+		#pragma omp atomic
+		undo_events += events;
+		if (depth > max_undo_depth) {
+			#pragma omp critical(rspr_stats)
+			if (depth > max_undo_depth)
+				max_undo_depth = depth;
+		}
+	}
+
+	void add_cluster(int leaves) {
+		clusters++;
+		cluster_leaves += leaves;
+		if (leaves > max_cluster_leaves)
+			max_cluster_leaves = leaves;
+	}
+
+	// write the statistics as a JSON object
+	void print_json(ostream &os) {
+		os << "{";
+		os << "\"bb_nodes\": " << bb_nodes;
+		os << ", \"bb_nodes_per_k\": [";
+		for(int k = 0; k < bb_nodes_per_k.size(); k++) {
+			if (k > 0)
+				os << ", ";
+			os << bb_nodes_per_k[k];
+		}
+		os << "]";
+		os << ", \"approx_prunes\": " << approx_prunes;
+		os << ", \"undo_events\": " << undo_events;
+		os << ", \"max_undo_depth\": " << max_undo_depth;
+		os << ", \"clusters\": " << clusters;
+		os << ", \"cluster_leaves\": " << cluster_leaves;
+		os << ", \"max_cluster_leaves\": " << max_cluster_leaves;
+		os << ", \"cluster_reductions\": " << cluster_reductions;
+		os << ", \"memo_hits\": " << memo_hits;
+		os << ", \"memo_misses\": " << memo_misses;
+		os << ", \"forked_tasks\": " << forked_tasks;
+		os << ", \"sync_twins_seconds\": " << phase_time[PHASE_SYNC_TWINS];
+		os << ", \"approx_seconds\": " << phase_time[PHASE_APPROX];
+		os << ", \"bb_seconds\": " << phase_time[PHASE_BB];
+		os << "}" << endl;
+	}
+};
+
+// the copyable part of a context
+class RsprOptions {
+	public:
+	bool BB = false;
+	bool APPROX_CHECK_COMPONENT = false;
+	bool APPROX_REVERSE_CUT_ONE_B = false;
+	bool APPROX_REVERSE_CUT_ONE_B_2 = false;
+	bool APPROX_CUT_ONE_B = false;
+	bool APPROX_CUT_TWO_B = false;
+	bool APPROX_CUT_TWO_B_ROOT = false;
+	bool APPROX_EDGE_PROTECTION = false;
+	bool CUT_ONE_B = false;
+	bool REVERSE_CUT_ONE_B = false;
+	bool REVERSE_CUT_ONE_B_2 = false;
+	bool REVERSE_CUT_ONE_B_3 = false;
+	bool CUT_TWO_B = false;
+	bool CUT_TWO_B_ROOT = false;
+	bool CUT_ALL_B = false;
+	bool CUT_AC_SEPARATE_COMPONENTS = false;
+	bool CUT_ONE_AB = false;
+	bool CLUSTER_REDUCTION = false;
+	bool PREFER_RHO = false;
+	bool MEMOIZE = false;
+	bool ALL_MAFS = false;
+	int NUM_CLUSTERS = 0;
+	int MAX_CLUSTERS = -1;
+	bool UNROOTED_MIN_APPROX = false;
+	bool VERBOSE = false;
+	bool CLAMP = false;
+	int MAX_SPR = 1000;
+	int CLUSTER_MAX_SPR = MAX_SPR;
+	int MIN_SPR = 0;
+	bool FIND_RATE = false;
+	bool EDGE_PROTECTION = false;
+	bool EDGE_PROTECTION_TWO_B = false;
+	bool ABORT_AT_FIRST_SOLUTION = false;
+	bool PREORDER_SIBLING_PAIRS = false;
+	bool DEEPEST_ORDER = false;
+	bool DEEPEST_PROTECTED_ORDER = false;
+	bool NEAR_PREORDER_SIBLING_PAIRS = false;
+	bool LEAF_REDUCTION = false;
+	bool LEAF_REDUCTION2 = false;
+	bool SPLIT_APPROX = false;
+	bool IN_SPLIT_APPROX = false;
+	int SPLIT_APPROX_THRESHOLD = 25;
+	float INITIAL_TREE_FRACTION = 0.4;
+	bool COUNT_LOSSES = false;
+	bool CUT_LOST = false;
+	bool CHECK_MERGE_DEPTH = false;
+	bool check_all_pairs = true;
+	bool PREFER_NONBRANCHING = false;
+	int CLUSTER_TUNE = -1;
+	int SIMPLE_UNROOTED_LEAF = 0;
+	bool PARALLEL_BB = false;
+	int PARALLEL_BB_DEPTH = 3;
+	// subproblems with at most this k remaining are not forked
+	int PARALLEL_BB_MIN_K = 4;
+	bool PARALLEL_CLUSTERS = false;
+	// time the phases of each solve
+	bool COLLECT_STATS = false;
+	// persistent pairwise distances, shared by all copies
+	DistanceCache *DISTANCE_CACHE = NULL;
+	// leaves of the gene trees in a supertree search, shared by all copies
+	GeneTreeIndex *GENE_TREE_INDEX = NULL;
+};
+
+class RsprContext : public RsprOptions {
+	private:
+	bool owns_memo;
+
+	// not assignable, copy construct instead
+	RsprContext &operator=(const RsprContext &c);
+
+	public:
+	ClusterMemo *memoized_clusters;
+	RsprStats stats;
+
+	// the state of the current call, not copied with the options
+
+	// cleared by the first call so only it reports progress
+	bool MAIN_CALL;
+	// remaining k above which rSPR_branch_and_bound_hlpr forks its branches
+	// into tasks, -1 when not forking
+	int BB_FORK_K;
+	// set when a forked search finds a solution, cancelling the others
+	bool BB_FOUND;
+
+	RsprContext() : RsprOptions() {
+		memoized_clusters = new ClusterMemo();
+		owns_memo = true;
+		MAIN_CALL = true;
+		BB_FORK_K = -1;
+		BB_FOUND = false;
+	}
+
+	/* copy the options and share the memo table. The copy continues the
+		 call of c, so it reports progress only if c would, but starts
+		 outside any forked search
+	*/
+	RsprContext(const RsprContext &c) : RsprOptions(c) {
+		memoized_clusters = c.memoized_clusters;
+		owns_memo = false;
+		MAIN_CALL = c.MAIN_CALL;
+		BB_FORK_K = -1;
+		BB_FOUND = false;
+	}
+
+	~RsprContext() {
+		if (owns_memo)
+			delete memoized_clusters;
+	}
+};
+
+// FUNCTIONS
+
+RsprContext *default_rspr_context();
+
+extern thread_local RsprContext *CURRENT_RSPR_CONTEXT;
+
+inline RsprContext *rspr_context() {
+	if (CURRENT_RSPR_CONTEXT == NULL)
+		return default_rspr_context();
+	return CURRENT_RSPR_CONTEXT;
+}
+
+// install context as the current context of this thread until destroyed
+class RsprContextScope {
+	private:
+	RsprContext *old_context;
+
+	public:
+	RsprContextScope(RsprContext *context) {
+		old_context = CURRENT_RSPR_CONTEXT;
+		CURRENT_RSPR_CONTEXT = context;
+	}
+
+	~RsprContextScope() {
+		CURRENT_RSPR_CONTEXT = old_context;
+	}
+};
+
+/* install a private copy of parent until destroyed, then add the
+	 statistics of the copy to parent
+*/
+class RsprContextCopy {
+	private:
+	RsprContext *parent;
+	RsprContext context;
+	RsprContextScope scope;
+
+	public:
+	RsprContextCopy(RsprContext *parent) : parent(parent),
+			context(*parent), scope(&context) {}
+
+	~RsprContextCopy() {
+		#pragma omp critical(rspr_stats)
+		parent->stats.add(context.stats);
+	}
+};
+
+// seconds on a monotonic wall clock
+inline double rspr_wall_time() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* add the wall time of a scope to a phase of the current context's
+	 statistics. Only the outermost timer of a phase counts, and nothing is
+	 timed unless COLLECT_STATS is set or inside a forked search, which
+	 shares its context with other threads
+*/
+class RsprTimer {
+	private:
+	RsprStats *stats;
+	int phase;
+	double start;
+
+	public:
+	RsprTimer(int phase) : phase(phase) {
+		RsprContext *context = rspr_context();
+		stats = NULL;
+		start = -1;
+		if (!context->COLLECT_STATS || context->BB_FORK_K >= 0)
+			return;
+		stats = &context->stats;
+		if (stats->phase_depth[phase]++ == 0)
+			start = rspr_wall_time();
+	}
+
+	~RsprTimer() {
+		if (stats == NULL)
+			return;
+		if (start >= 0)
+			stats->phase_time[phase] += rspr_wall_time() - start;
+		stats->phase_depth[phase]--;
+	}
+};
+
+/* add the branch-and-bound nodes expanded in a scope to the count for
+	 k, unless it is nested in another search or inside a forked search
+*/
+class RsprNodeCounter {
+	private:
+	RsprStats *stats;
+	int k;
+	long long start;
+
+	public:
+	RsprNodeCounter(int k) : k(k) {
+		RsprContext *context = rspr_context();
+		stats = NULL;
+		if (context->BB_FORK_K >= 0)
+			return;
+		stats = &context->stats;
+		if (stats->bb_depth++ == 0)
+			start = stats->bb_nodes;
+		else
+			start = -1;
+	}
+
+	~RsprNodeCounter() {
+		if (stats == NULL)
+			return;
+		if (start >= 0)
+			stats->add_bb_nodes(k, stats->bb_nodes - start);
+		stats->bb_depth--;
+	}
+};
+
+/* write the statistics of the current context as JSON to file, or to
+	 stderr if file is empty
+*/
+void print_rspr_stats(const string &file);
+
+#endif
@@ -0,0 +1,100 @@
+/*******************************************************************************
+SiblingPair.cpp
+
+Data structure for a sibling pair of a binary tree
+
+Copyright 2012-2014 Chris Whidden
+cwhidden@dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include "SiblingPair.h"
+
+void find_sibling_pairs_set_hlpr(Node *n,
+			SiblingPairSet *sibling_pairs) {
+		Node *lchild = n->lchild();
+		Node *rchild = n->rchild();
+		bool lchild_leaf = false;
+		bool rchild_leaf = false;
+		if (lchild != NULL) {
+			if (lchild->is_leaf())
+				lchild_leaf = true;
+			else
+				find_sibling_pairs_set_hlpr(lchild,sibling_pairs);
+		}
+		if (rchild != NULL) {
+			if (rchild->is_leaf())
+				rchild_leaf = true;
+			else
+				find_sibling_pairs_set_hlpr(rchild,sibling_pairs);
+		}
+		if (lchild_leaf && rchild_leaf) {
+			sibling_pairs->insert(SiblingPair(lchild,rchild));
+			//lchild->add_to_sibling_pairs(sibling_pairs, 1);
+			//rchild->add_to_sibling_pairs(sibling_pairs, 2);
+		}
+	}
+
+void append_sibling_pairs_set(Node *n,SiblingPairSet *sibling_pairs) {
+		find_sibling_pairs_set_hlpr(n,sibling_pairs);
+	}
+
+SiblingPairSet *find_sibling_pairs_set(Node *n) {
+		SiblingPairSet *sibling_pairs = new SiblingPairSet();
+		find_sibling_pairs_set_hlpr(n,sibling_pairs);
+		return sibling_pairs;
+	}
+
+SiblingPairSet *find_sibling_pairs_set(Forest *f) {
+		SiblingPairSet *sibling_pairs = new SiblingPairSet();
+		for(int i = 0; i < f->num_components(); i++) {
+			Node *component = f->get_component(i);
+			append_sibling_pairs_set(component,sibling_pairs);
+		}
+		return sibling_pairs;
+	}
+
+void append_sibling_pairs_list(Node *n, SiblingPairList *sibling_pairs) {
+		Node *lchild = n->lchild();
+		Node *rchild = n->rchild();
+		bool lchild_leaf = false;
+		bool rchild_leaf = false;
+		if (lchild != NULL) {
+			if (lchild->is_leaf())
+				lchild_leaf = true;
+			else
+				append_sibling_pairs_list(lchild,sibling_pairs);
+		}
+		if (rchild != NULL) {
+			if (rchild->is_leaf())
+				rchild_leaf = true;
+			else
+				append_sibling_pairs_list(rchild,sibling_pairs);
+		}
+		if (lchild_leaf && rchild_leaf) {
+			sibling_pairs->push_back(lchild);
+			sibling_pairs->push_back(rchild);
+		}
+	}
+
+void append_sibling_pairs_list(Forest *f, SiblingPairList *sibling_pairs) {
+		for(int i = 0; i < f->num_components(); i++)
+			append_sibling_pairs_list(f->get_component(i), sibling_pairs);
+	}
@@ -33,7 +33,7 @@ along with rspr.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <iostream>
 #include <sstream>
-#include <set>
+#include <vector>
 #include "Node.h"
 
 using namespace std;
@@ -66,51 +66,202 @@ class SiblingPair {
 	}
 };
 
-	// TODO: binary only
-	void find_sibling_pairs_set_hlpr(Node *n,
-			set<SiblingPair> *sibling_pairs) {
-		Node *lchild = n->lchild();
-		Node *rchild = n->rchild();
-		bool lchild_leaf = false;
-		bool rchild_leaf = false;
-		if (lchild != NULL) {
-			if (lchild->is_leaf())
-				lchild_leaf = true;
-			else
-				find_sibling_pairs_set_hlpr(lchild,sibling_pairs);
+/*
+	The sibling pairs of the branch and bound, at most one for each key.
+
+	Pairs are stored in a flat array indexed by their key, the smaller
+	preorder number of the two nodes, with a bitmap of the occupied slots.
+	Insert and erase are O(1) and the pairs are visited in increasing key
+	order, as a set ordered by key would, by scanning the bitmap a word at
+	a time. Slots are offset by one so that unnumbered nodes (key -1)
+	still fit.
+*/
+class SiblingPairSet {
+	private:
+	vector<SiblingPair> pairs;
+	vector<unsigned long long> present;
+	int count;
+
+	// first occupied slot at or after s, or -1
+	int scan(int s) const {
+		int w = s >> 6;
+		if (w >= present.size())
+			return -1;
+		unsigned long long bits = present[w] & (~0ULL << (s & 63));
+		while (bits == 0) {
+			w++;
+			if (w >= present.size())
+				return -1;
+			bits = present[w];
 		}
-		if (rchild != NULL) {
-			if (rchild->is_leaf())
-				rchild_leaf = true;
-			else
-				find_sibling_pairs_set_hlpr(rchild,sibling_pairs);
+		return (w << 6) + __builtin_ctzll(bits);
+	}
+
+	public:
+	SiblingPairSet() {
+		count = 0;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	int size() const {
+		return count;
+	}
+
+	void clear() {
+		pairs.clear();
+		present.clear();
+		count = 0;
+	}
+
+	// the slot holding the pair with this key, or -1
+	int find(int key) const {
+		int s = key + 1;
+		if (s < 0 || s >= pairs.size()
+				|| !(present[s >> 6] & (1ULL << (s & 63))))
+			return -1;
+		return s;
+	}
+
+	/* add sp unless a pair with the same key is already stored.
+		 Returns the slot of sp or of the pair that kept it out
+	*/
+	int insert(const SiblingPair &sp) {
+		int s = sp.key + 1;
+		if (s >= pairs.size()) {
+			int new_size = 2 * pairs.size();
+			if (new_size < s + 1)
+				new_size = s + 1;
+			if (new_size < 64)
+				new_size = 64;
+			pairs.resize(new_size);
+			present.resize((new_size + 63) >> 6, 0);
 		}
-		if (lchild_leaf && rchild_leaf) {
-			sibling_pairs->insert(SiblingPair(lchild,rchild));
-			//lchild->add_to_sibling_pairs(sibling_pairs, 1);
-			//rchild->add_to_sibling_pairs(sibling_pairs, 2);
+		unsigned long long bit = 1ULL << (s & 63);
+		if (!(present[s >> 6] & bit)) {
+			present[s >> 6] |= bit;
+			pairs[s] = sp;
+			count++;
 		}
+		return s;
+	}
+
+	void erase(int s) {
+		present[s >> 6] &= ~(1ULL << (s & 63));
+		count--;
+	}
+
+	SiblingPair &at(int s) {
+		return pairs[s];
+	}
+
+	// slot of the pair with the smallest key, or -1
+	int first() const {
+		return scan(0);
+	}
+
+	// slot of the pair with the next larger key, or -1
+	int next(int s) const {
+		return scan(s + 1);
+	}
+};
+
+/*
+	The sibling pair worklist of the approximation, a ring buffer of nodes
+	with the same push and pop operations at either end that the
+	approximation used on a list<Node *>, without allocating for each
+	node. The two nodes of a pair are adjacent.
+*/
+class SiblingPairList {
+	private:
+	vector<Node *> nodes;
+	int head;
+	int count;
+
+	void grow() {
+		int old_size = nodes.size();
+		vector<Node *> new_nodes = vector<Node *>(old_size == 0 ? 64 : 2 * old_size);
+		for(int i = 0; i < count; i++)
+			new_nodes[i] = nodes[(head + i) & (old_size - 1)];
+		nodes.swap(new_nodes);
+		head = 0;
+	}
+
+	public:
+	SiblingPairList() {
+		head = 0;
+		count = 0;
 	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	int size() const {
+		return count;
+	}
+
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	Node *operator[](int i) const {
+		return nodes[(head + i) & (nodes.size() - 1)];
+	}
+
+	Node *front() const {
+		return nodes[head];
+	}
+
+	Node *back() const {
+		return (*this)[count - 1];
+	}
+
+	void push_front(Node *n) {
+		if (count == nodes.size())
+			grow();
+		head = (head - 1) & (nodes.size() - 1);
+		nodes[head] = n;
+		count++;
+	}
+
+	void push_back(Node *n) {
+		if (count == nodes.size())
+			grow();
+		nodes[(head + count) & (nodes.size() - 1)] = n;
+		count++;
+	}
+
+	void pop_front() {
+		head = (head + 1) & (nodes.size() - 1);
+		count--;
+	}
+
+	void pop_back() {
+		count--;
+	}
+};
+
+	// TODO: binary only
+	void find_sibling_pairs_set_hlpr(Node *n,
+			SiblingPairSet *sibling_pairs);
 	
 	// find the sibling pairs in this node's subtree
-	void append_sibling_pairs_set(Node *n,set<SiblingPair> *sibling_pairs) {
-		find_sibling_pairs_set_hlpr(n,sibling_pairs);
-	}
+	void append_sibling_pairs_set(Node *n,SiblingPairSet *sibling_pairs);
 
 	// find the sibling pairs in this node's subtree
-	set<SiblingPair> *find_sibling_pairs_set(Node *n) {
-		set<SiblingPair> *sibling_pairs = new set<SiblingPair>();
-		find_sibling_pairs_set_hlpr(n,sibling_pairs);
-		return sibling_pairs;
-	}
+	SiblingPairSet *find_sibling_pairs_set(Node *n);
 
 	// return a set of the sibling pairs
-	set<SiblingPair> *find_sibling_pairs_set(Forest *f) {
-		set<SiblingPair> *sibling_pairs = new set<SiblingPair>();
-		for(int i = 0; i < f->num_components(); i++) {
-			Node *component = f->get_component(i);
-			append_sibling_pairs_set(component,sibling_pairs);
-		}
-		return sibling_pairs;
-	}
+	SiblingPairSet *find_sibling_pairs_set(Forest *f);
+
+	// TODO: binary only
+	// same order as Node::find_sibling_pairs
+	void append_sibling_pairs_list(Node *n, SiblingPairList *sibling_pairs);
+
+	// same order as Forest::find_sibling_pairs
+	void append_sibling_pairs_list(Forest *f, SiblingPairList *sibling_pairs);
 #endif
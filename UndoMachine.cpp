@@ -0,0 +1,304 @@
+/*******************************************************************************
+UndoMachine.cpp
+
+Data structure for recording and undoing tree alterations
+
+Copyright 2012-2014 Chris Whidden
+whidden@cs.dal.ca
+http://kiwi.cs.dal.ca/Software/RSPR
+March 3, 2014
+Version 1.2.1
+
+This file is part of rspr.
+
+rspr is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+rspr is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with rspr.  If not, see <http://www.gnu.org/licenses/>.
+*******************************************************************************/
+
+#include "UndoMachine.h"
+
+// revert a recorded change, other than a name change
+void undo_event(UndoEvent &event) {
+	Node *node = event.node;
+	Node *other = event.other;
+	switch(event.type) {
+		case UNDO_ADD_RHO: {
+			Forest *F = (Forest *)event.container;
+			F->set_rho(false);
+			F->get_component(F->num_components()-1)->delete_tree();
+			F->erase_components(F->num_components()-1,F->num_components());
+			break;
+		}
+		case UNDO_ADD_COMPONENT: {
+			Forest *F = (Forest *)event.container;
+			F->erase_components(F->num_components()-1,F->num_components());
+			break;
+		}
+		case UNDO_ADD_COMPONENT_TO_FRONT:
+			((Forest *)event.container)->erase_components(0,1);
+			break;
+		case UNDO_CUT_PARENT:
+			if (event.x == 1) {
+				if (other->is_leaf())
+					other->add_child(node);
+				else
+					other->insert_child(other->get_children().front(), node);
+			}
+			else if (event.x == 2)
+				other->add_child(node);
+			node->set_depth(event.y);
+			break;
+		case UNDO_CLEAR_SIBLING_PAIR:
+			node->set_sibling_pair_status(1);
+			other->set_sibling_pair_status(2);
+			if (event.x == 0)
+				other->set_sibling(node);
+			else if (event.y == 0)
+				node->set_sibling(other);
+			break;
+		case UNDO_POP_CLEARED_SIBLING_PAIR: {
+			list<Node *> *sibling_pairs = (list<Node *> *)event.container;
+			sibling_pairs->push_back(other);
+			sibling_pairs->push_back(node);
+			break;
+		}
+		case UNDO_POP_SIBLING_PAIR: {
+			SiblingPairList *sibling_pairs = (SiblingPairList *)event.container;
+			sibling_pairs->push_back(other);
+			sibling_pairs->push_back(node);
+			break;
+		}
+		case UNDO_CONTRACT_SIBLING_PAIR:
+			if (event.flag) {
+				node->undo_contract_sibling_pair();
+				if (event.x > -1)
+					node->lchild()->set_depth(event.x);
+				if (event.y > -1)
+					node->rchild()->set_depth(event.y);
+			}
+			if (event.flag2)
+				node->protect_edge();
+			break;
+		case UNDO_ADD_TO_FRONT_SIBLING_PAIRS: {
+			SiblingPairList *sibling_pairs = (SiblingPairList *)event.container;
+			if (!sibling_pairs->empty()) {
+				sibling_pairs->pop_front();
+				sibling_pairs->pop_front();
+			}
+			break;
+		}
+		case UNDO_ADD_TO_SIBLING_PAIRS: {
+			SiblingPairList *sibling_pairs = (SiblingPairList *)event.container;
+			if (!sibling_pairs->empty()) {
+				sibling_pairs->pop_back();
+				sibling_pairs->pop_back();
+			}
+			break;
+		}
+		case UNDO_ADD_TO_SET_SIBLING_PAIRS:
+		case UNDO_REMOVE_SET_SIBLING_PAIRS: {
+			SiblingPairSet *sibling_pairs = (SiblingPairSet *)event.container;
+			if (event.type == UNDO_REMOVE_SET_SIBLING_PAIRS) {
+				SiblingPair pair = SiblingPair();
+				pair.a = node;
+				pair.c = other;
+				pair.key = event.x;
+				pair.key2 = event.y;
+				sibling_pairs->insert(pair);
+			}
+			else {
+				int s = sibling_pairs->find(event.x);
+				if (s >= 0)
+					sibling_pairs->erase(s);
+			}
+			break;
+		}
+		case UNDO_ADD_IN_SIBLING_PAIRS: {
+			list<Node *> *sibling_pairs = (list<Node *> *)event.container;
+			if (!sibling_pairs->empty()) {
+				list<Node *>::iterator c = sibling_pairs->begin();
+				for(int i = 0; i <= event.x && c != sibling_pairs->end(); i++) {
+					c++;
+				}
+				if (c != sibling_pairs->end()) {
+					list<Node *>::iterator rem = c;
+					c++;
+					sibling_pairs->erase(rem);
+					rem = c;
+					c++;
+					sibling_pairs->erase(rem);
+				}
+			}
+			break;
+		}
+		case UNDO_SET_TWIN:
+			node->set_twin(other);
+			break;
+		case UNDO_CHANGE_NAME:
+			break;
+		case UNDO_CHANGE_EDGE_PRE_INTERVAL:
+			node->set_edge_pre_start(event.x);
+			node->set_edge_pre_end(event.y);
+			break;
+		case UNDO_CHANGE_PRE_NUM:
+			node->set_preorder_number(event.x);
+			break;
+		case UNDO_CHANGE_RIGHT_CHILD:
+			if (other != NULL) {
+				//node->add_child_keep_depth(other);
+				node->add_child(other);
+				other->set_depth(event.x);
+			}
+			else
+				if (node->rchild() != NULL)
+					node->rchild()->cut_parent();
+			break;
+		case UNDO_CHANGE_LEFT_CHILD:
+			if (other != NULL) {
+				//node->add_child_keep_depth(other);
+				node->add_child(other);
+				other->set_depth(event.x);
+			}
+			else
+				if (node->lchild() != NULL)
+					node->lchild()->cut_parent();
+			break;
+		case UNDO_ADD_CHILD:
+			if (node != NULL) {
+				node->cut_parent();
+				node->set_depth(event.x);
+			}
+			break;
+		case UNDO_ADD_CONTRACTED_LC:
+			node->set_contracted_lc(NULL);
+			break;
+		case UNDO_ADD_CONTRACTED_RC:
+			node->set_contracted_rc(NULL);
+			break;
+		case UNDO_CREATE_NODE:
+			if (node != NULL)
+				delete node;
+			break;
+		case UNDO_PROTECT_EDGE:
+			if (node != NULL)
+				node->unprotect_edge();
+			break;
+		case UNDO_UNPROTECT_EDGE:
+			if (node != NULL)
+				node->protect_edge();
+			break;
+		case UNDO_LIST_PUSH_BACK:
+			((list<Node *> *)event.container)->pop_back();
+			break;
+		case UNDO_LIST_POP_BACK:
+			if (node != NULL)
+				((list<Node *> *)event.container)->push_back(node);
+			break;
+	}
+}
+
+void ContractEvent(UndoMachine *um, Node *n, int bookmark) {
+		Node *parent = n->parent();
+		Node *child;
+		Node *lc = n->lchild();
+		Node *rc = n->rchild();
+		Node *ret = NULL;
+		// contract out this node and give child to parent
+		if (parent != NULL) {
+			if (lc && !rc) {
+				child = lc;
+				um->add_event(ChangeEdgePreInterval(child));
+				um->add_event(CutParent(child));
+				um->add_event(CutParent(n));
+				if (n->is_protected() && !child->is_protected())
+					um->add_event(ProtectEdge(child));
+			}
+			else if (rc && !lc) {
+				child = rc;
+				um->add_event(ChangeEdgePreInterval(child));
+				um->add_event(CutParent(child));
+				um->add_event(CutParent(n));
+				if (n->is_protected() && !child->is_protected())
+					um->add_event(ProtectEdge(child));
+			}
+			else if (lc == NULL && rc == NULL) {
+				um->insert_event(bookmark, CutParent(n));
+				parent->delete_child(n);
+				ContractEvent(um, parent);
+				parent->add_child(n);
+			}
+		}
+		// if no parent then take children of single child and remove it
+		else {
+
+			// dead component or singleton, will be cleaned up by the forest
+			if (n->get_children().empty()) {
+				um->add_event(ChangeName(n));
+			}
+			else if (n->get_children().size() == 1) {
+				child = n->get_children().front();
+//				if (rc == NULL) {
+//					um->add_event(ChangeRightChild(n));
+//					child = lc;
+//				}
+//				else {
+//					um->add_event(ChangeLeftChild(n));
+//					child = rc;
+//				}
+				um->add_event(CutParent(child));
+				/* cluster hack - if we delete a cluster node then
+				 * we may try to use it later. This only happens once
+				 * per cluster so we can spend linear time to update
+				 * the forest
+				 */
+				if (child->get_num_clustered_children() > 0) {
+					//um->add_event(CutParent(n));
+				}
+				else {
+					// if child is a leaf then get rid of this so we don't lose refs
+					// problem: if the child is not c, then we want to copy
+					// otherwise we don't
+					// copy other parameters and join the twin
+					//to this if the child is a label
+
+					Node *new_lc = child->lchild();
+					Node *new_rc = child->rchild();
+					if (child->is_leaf()) {
+						if (child->get_twin() != NULL) {
+							um->add_event(SetTwin(n));
+							um->add_event(SetTwin(child->get_twin()));
+						}
+						um->add_event(ChangeName(n));
+					}
+					um->add_event(ChangePreNum(n));
+					//um->add_event(CutParent(n));
+					list<Node *>::iterator c;
+					for(c = child->get_children().begin();
+							c != child->get_children().end();
+							c++) {
+						um->add_event(CutParent(*c));
+					}
+					if (child->get_contracted_lc() != NULL)
+						um->add_event(AddContractedLC(n));
+					if (child->get_contracted_rc() != NULL)
+						um->add_event(AddContractedRC(n));
+				}
+			}
+		}
+
+	}
+
+void ContractEvent(UndoMachine *um, Node *n) {
+	int bookmark = um->get_bookmark();
+	ContractEvent(um, n, bookmark);
+}
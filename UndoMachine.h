@@ -30,58 +30,136 @@ along with rspr.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Node.h"
 #include "Forest.h"
+#include "SiblingPair.h"
 #include <list>
-#include <typeinfo>
+#include <vector>
 
 
 class Node;
 
-class Undoable {
+/* The kinds of recorded changes. Each has a class below that fills in an
+	 UndoEvent and a case in undo_event that reverts it
+*/
+enum UndoEventType {
+	UNDO_ADD_RHO,
+	UNDO_ADD_COMPONENT,
+	UNDO_ADD_COMPONENT_TO_FRONT,
+	UNDO_CUT_PARENT,
+	UNDO_CLEAR_SIBLING_PAIR,
+	UNDO_POP_CLEARED_SIBLING_PAIR,
+	UNDO_POP_SIBLING_PAIR,
+	UNDO_CONTRACT_SIBLING_PAIR,
+	UNDO_ADD_TO_FRONT_SIBLING_PAIRS,
+	UNDO_ADD_TO_SIBLING_PAIRS,
+	UNDO_ADD_TO_SET_SIBLING_PAIRS,
+	UNDO_REMOVE_SET_SIBLING_PAIRS,
+	UNDO_ADD_IN_SIBLING_PAIRS,
+	UNDO_SET_TWIN,
+	UNDO_CHANGE_NAME,
+	UNDO_CHANGE_EDGE_PRE_INTERVAL,
+	UNDO_CHANGE_PRE_NUM,
+	UNDO_CHANGE_RIGHT_CHILD,
+	UNDO_CHANGE_LEFT_CHILD,
+	UNDO_ADD_CHILD,
+	UNDO_ADD_CONTRACTED_LC,
+	UNDO_ADD_CONTRACTED_RC,
+	UNDO_CREATE_NODE,
+	UNDO_PROTECT_EDGE,
+	UNDO_UNPROTECT_EDGE,
+	UNDO_LIST_PUSH_BACK,
+	UNDO_LIST_POP_BACK
+};
+
+/* A recorded change, stored by value in the UndoMachine log. The event
+	 classes only set the fields their undo needs and add no members of
+	 their own, so they can be copied into the log as an UndoEvent.
+*/
+class UndoEvent {
 	public:
-	virtual ~Undoable() {}
-	virtual void undo() = 0;
+	UndoEventType type;
+	Node *node;				// the node that was changed
+	Node *other;			// its old parent, child, twin or sibling
+	void *container;	// the forest, list or set that was changed
+	int x;
+	int y;
+	bool flag;
+	bool flag2;
+
+	UndoEvent() {
+		node = NULL;
+		other = NULL;
+		container = NULL;
+		x = 0;
+		y = 0;
+		flag = false;
+		flag2 = false;
+	}
 };
 
+void undo_event(UndoEvent &event);
+
 class UndoMachine {
 	public:
-	list<Undoable *> events;
+	vector<UndoEvent> events;
+	// old names for the UNDO_CHANGE_NAME events, in the same order
+	vector<string> names;
 	int size;
+	// events added and the most held at once, for the statistics
+	int events_added;
+	int max_size;
 
 	UndoMachine() {
-		events = list<Undoable *>();
+		events = vector<UndoEvent>();
+		names = vector<string>();
 		size = 0;
+		events_added = 0;
+		max_size = 0;
 	}
 
-	void add_event(Undoable *event) {
+	~UndoMachine() {
+		if (events_added > 0)
+			rspr_context()->stats.add_undo(events_added, max_size);
+	}
+
+	void add_event(const UndoEvent &event) {
 		events.push_back(event);
+		if (event.type == UNDO_CHANGE_NAME)
+			names.push_back(event.node->get_name());
 		size++;
+		events_added++;
+		if (size > max_size)
+			max_size = size;
 	}
 
-	void insert_event(list<Undoable *>::iterator i, Undoable *event) {
-		list<Undoable *>::iterator j = i;
-		j++;
-		events.insert(j, event);
+	/* insert an event just after the bookmark. Only for events that do
+		 not save a name
+	*/
+	void insert_event(int bookmark, const UndoEvent &event) {
+		events.insert(events.begin() + (bookmark + 1), event);
 		size++;
+		events_added++;
+		if (size > max_size)
+			max_size = size;
 	}
 
-	 list<Undoable *>::iterator get_bookmark() {
-		 list<Undoable *>::iterator bookmark = events.end();
-		 if (size > 0)
-		 	bookmark--;
-		 else
-			 bookmark = events.begin();
-		 return bookmark;
-	 }
+	// the position of the last event, -1 if there are none
+	int get_bookmark() {
+		return size - 1;
+	}
 
 	void undo() {
 		if (!events.empty()) {
-			Undoable *event = events.back();
+			UndoEvent event = events.back();
 #ifdef DEBUG_UNDO
-			cout << typeid(*event).name() << endl;
+			cout << "undo event " << event.type << endl;
 #endif
 			events.pop_back();
-			event->undo();
-			delete event;
+			if (event.type == UNDO_CHANGE_NAME) {
+				event.node->set_name(names.back());
+				names.pop_back();
+			}
+			else
+				undo_event(event);
 			size--;
 		}
 	}
@@ -102,9 +180,9 @@ class UndoMachine {
 
 	void clear_to(int to) {
 		while (size > to) {
-			Undoable *event = events.back();
+			if (events.back().type == UNDO_CHANGE_NAME)
+				names.pop_back();
 			events.pop_back();
-			delete event;
 			size--;
 		}
 
@@ -117,613 +195,308 @@ class UndoMachine {
 
 void ContractEvent(UndoMachine *um, Node *n);
 
-class AddRho : public Undoable {
+class AddRho : public UndoEvent {
 	public:
-	Forest *F;
 	AddRho(Forest *f) {
-		F = f;
-	}
-	void undo() {
-		F->set_rho(false);
-		F->get_component(F->num_components()-1)->delete_tree();
-		F->erase_components(F->num_components()-1,F->num_components());
+		type = UNDO_ADD_RHO;
+		container = f;
 	}
 };
 
-class AddComponent : public Undoable {
+class AddComponent : public UndoEvent {
 	public:
-	Forest *F;
 	AddComponent(Forest *f) {
-		F = f;
-	}
-	void undo() {
-		F->erase_components(F->num_components()-1,F->num_components());
+		type = UNDO_ADD_COMPONENT;
+		container = f;
 	}
 };
 
-class AddComponentToFront : public Undoable {
+class AddComponentToFront : public UndoEvent {
 	public:
-	Forest *F;
 	AddComponentToFront(Forest *f) {
-		F = f;
-	}
-	void undo() {
-		F->erase_components(0,1);
+		type = UNDO_ADD_COMPONENT_TO_FRONT;
+		container = f;
 	}
 };
 
 // TODO: use new insert_child function with a stored successor sibling
 // does the end work? maybe a seperate variable for that?
-class CutParent : public Undoable {
+// node is the child, other its parent, x the branch and y the depth
+class CutParent : public UndoEvent {
 	public:
-	Node *child;
-	Node *parent;
-	int branch;
-	int depth;
 	CutParent(Node *c) {
-		child = c;
-		parent = c->parent();
-		branch = 0;
-		depth = c->get_depth();
-		if (parent != NULL) {
-			if (parent->lchild() == child)
-				branch = 1;
-			else
-				branch = 2;
-		}
-	}
-
-	void undo() {
-		if (branch == 1) {
-			if (parent->is_leaf())
-				parent->add_child(child);
+		type = UNDO_CUT_PARENT;
+		node = c;
+		other = c->parent();
+		x = 0;
+		y = c->get_depth();
+		if (other != NULL) {
+			if (other->lchild() == node)
+				x = 1;
 			else
-				parent->insert_child(parent->get_children().front(), child);
+				x = 2;
 		}
-		else if (branch == 2)
-			parent->add_child(child);
-		child->set_depth(depth);
 	}
 };
 
-class ClearSiblingPair : public Undoable {
+// node and other are a and c, x and y their statuses
+class ClearSiblingPair : public UndoEvent {
 	public:
-		Node *a;
-		Node *c;
-		int a_status;
-		int c_status;
-		ClearSiblingPair(Node *x, Node *y) {
-			if (x->get_sibling_pair_status() == 1 ||
-					y->get_sibling_pair_status() == 2) {
-				a = x;
-				c = y;
+		ClearSiblingPair(Node *a, Node *c) {
+			type = UNDO_CLEAR_SIBLING_PAIR;
+			if (a->get_sibling_pair_status() == 1 ||
+					c->get_sibling_pair_status() == 2) {
+				node = a;
+				other = c;
 			}
 			else {
-				a = y;
-				c = x;
+				node = c;
+				other = a;
 			}
-			a_status = a->get_sibling_pair_status();
-			c_status = c->get_sibling_pair_status();
-		}
-
-		void undo() {
-			a->set_sibling_pair_status(1);
-			c->set_sibling_pair_status(2);
-			if (a_status == 0) {
-				c->set_sibling(a);
-			}
-			else if (c_status == 0) {
-				a->set_sibling(c);
-			}
-
+			x = node->get_sibling_pair_status();
+			y = other->get_sibling_pair_status();
 		}
 };
 
-class PopClearedSiblingPair : public Undoable {
+class PopClearedSiblingPair : public UndoEvent {
 	public:
-		Node *a;
-		Node *c;
-		int a_status;
-		int c_status;
-
-		list<Node *> *sibling_pairs;
-		PopClearedSiblingPair(Node *x, Node *y, list<Node *> *s) {
-			sibling_pairs = s;
-			a = x;
-			c = y;
-		}
-
-		void undo() {
-			sibling_pairs->push_back(c);
-			sibling_pairs->push_back(a);
+		PopClearedSiblingPair(Node *a, Node *c, list<Node *> *s) {
+			type = UNDO_POP_CLEARED_SIBLING_PAIR;
+			container = s;
+			node = a;
+			other = c;
 		}
 };
 
-class PopSiblingPair : public Undoable {
+class PopSiblingPair : public UndoEvent {
 	public:
-		Node *a;
-		Node *c;
-		list<Node *> *sibling_pairs;
-		PopSiblingPair(Node *x, Node *y, list<Node *> *s) {
-			sibling_pairs = s;
-				a = x;
-				c = y;
-		}
-
-		void undo() {
-			sibling_pairs->push_back(c);
-			sibling_pairs->push_back(a);
+		PopSiblingPair(Node *a, Node *c, SiblingPairList *s) {
+			type = UNDO_POP_SIBLING_PAIR;
+			container = s;
+			node = a;
+			other = c;
 		}
 };
 
-class ContractSiblingPair : public Undoable {
+/* x and y are the depths of the children, flag is set for a binary node
+	 and flag2 if the node was protected
+*/
+class ContractSiblingPair : public UndoEvent {
 	public:
-		Node *node;
-		int c1_depth;
-		int c2_depth;
-		bool binary_node;
-		bool node_protected;
 		ContractSiblingPair(Node *n) {
 			init(n);
-			if (n->is_protected())
-				node_protected = true;
-			else
-				node_protected = false;
+			flag2 = n->is_protected();
 		}
 		ContractSiblingPair(Node *n, Node *child1, Node *child2,
 				UndoMachine *um) {
 			if (n->get_children().size() == 2)
 				init(n);
 			else {
-				um->add_event(new CutParent(child1));
-				um->add_event(new CutParent(child2));
-				binary_node = false;
+				um->add_event(CutParent(child1));
+				um->add_event(CutParent(child2));
+				type = UNDO_CONTRACT_SIBLING_PAIR;
+				flag = false;
 				node = n;
 			}
-			if (n->is_protected())
-				node_protected = true;
-			else
-				node_protected = false;
+			flag2 = n->is_protected();
 		}
 
 		void init(Node *n) {
+			type = UNDO_CONTRACT_SIBLING_PAIR;
 			node = n;
 			if (n->lchild() != NULL)
-				c1_depth = n->lchild()->get_depth();
+				x = n->lchild()->get_depth();
 			else
-				c1_depth = -1;
+				x = -1;
 			if (n->rchild() != NULL)
-				c2_depth = n->rchild()->get_depth();
+				y = n->rchild()->get_depth();
 			else
-				c2_depth = -1;
-			binary_node = true;
-		}
-
-		void undo() {
-			if (binary_node) {
-				node->undo_contract_sibling_pair();
-				if (c1_depth > -1)
-					node->lchild()->set_depth(c1_depth);
-				if (c2_depth > -1)
-					node->rchild()->set_depth(c2_depth);
-			}
-			if (node_protected)
-				node->protect_edge();
+				y = -1;
+			flag = true;
 		}
 };
 
-class AddToFrontSiblingPairs : public Undoable {
+class AddToFrontSiblingPairs : public UndoEvent {
 	public:
-		list<Node *> *sibling_pairs;
-		AddToFrontSiblingPairs(list<Node *> *s) {
-			sibling_pairs = s;
-		}
-		void undo() {
-			if (!sibling_pairs->empty()) {
-				sibling_pairs->pop_front();
-				sibling_pairs->pop_front();
-			}
+		AddToFrontSiblingPairs(SiblingPairList *s) {
+			type = UNDO_ADD_TO_FRONT_SIBLING_PAIRS;
+			container = s;
 		}
 };
 
-class AddToSiblingPairs : public Undoable {
+class AddToSiblingPairs : public UndoEvent {
 	public:
-		list<Node *> *sibling_pairs;
-		AddToSiblingPairs(list<Node *> *s) {
-			sibling_pairs = s;
-		}
-		void undo() {
-			if (!sibling_pairs->empty()) {
-				sibling_pairs->pop_back();
-				sibling_pairs->pop_back();
-			}
+		AddToSiblingPairs(SiblingPairList *s) {
+			type = UNDO_ADD_TO_SIBLING_PAIRS;
+			container = s;
 		}
 };
 
-class AddToSetSiblingPairs : public Undoable {
+// the pair is kept as node, other, x and y
+class AddToSetSiblingPairs : public UndoEvent {
 	public:
-		set<SiblingPair> *sibling_pairs;
-		SiblingPair pair;
-		AddToSetSiblingPairs(set<SiblingPair> *sp, SiblingPair p) {
-			sibling_pairs = sp;
-			//pair = SiblingPair(p->a,p->c);
-			pair = p;
-		}
-		void undo() {
-			if (!sibling_pairs->empty()) {
-				sibling_pairs->erase(pair);
-			}
+		AddToSetSiblingPairs(SiblingPairSet *sp, SiblingPair p) {
+			type = UNDO_ADD_TO_SET_SIBLING_PAIRS;
+			container = sp;
+			node = p.a;
+			other = p.c;
+			x = p.key;
+			y = p.key2;
 		}
 };
 
-class RemoveSetSiblingPairs : public Undoable {
+class RemoveSetSiblingPairs : public UndoEvent {
 	public:
-		set<SiblingPair> *sibling_pairs;
-		SiblingPair pair;
-		RemoveSetSiblingPairs(set<SiblingPair> *sp, SiblingPair p) {
-			sibling_pairs = sp;
-			pair = p;
-		}
-		void undo() {
-			sibling_pairs->insert(pair);
+		RemoveSetSiblingPairs(SiblingPairSet *sp, SiblingPair p) {
+			type = UNDO_REMOVE_SET_SIBLING_PAIRS;
+			container = sp;
+			node = p.a;
+			other = p.c;
+			x = p.key;
+			y = p.key2;
 		}
 };
 
-class AddInSiblingPairs : public Undoable {
+class AddInSiblingPairs : public UndoEvent {
 	public:
-		list<Node *> *sibling_pairs;
-		int pos;
-		AddInSiblingPairs(list<Node *> *s, int p) {
-			sibling_pairs = s;
-			pos = p;
-		}
-		void undo() {
-			if (!sibling_pairs->empty()) {
-				list<Node *>::iterator c = sibling_pairs->begin();
-				for(int i = 0; i <= pos && c != sibling_pairs->end(); i++) {
-					c++;
-				}
-				if (c != sibling_pairs->end()) {
-					list<Node *>::iterator rem = c;
-					c++;
-					sibling_pairs->erase(rem);
-					rem = c;
-					c++;
-					sibling_pairs->erase(rem);
-				}
-			}
+		AddInSiblingPairs(list<Node *> *s, int pos) {
+			type = UNDO_ADD_IN_SIBLING_PAIRS;
+			container = s;
+			x = pos;
 		}
 };
 
-class SetTwin : public Undoable {
+class SetTwin : public UndoEvent {
 	public:
-		Node *node;
-		Node *twin;
-
 		SetTwin(Node *n) {
+			type = UNDO_SET_TWIN;
 			node = n;
-			twin = n->get_twin();
-		}
-
-		void undo() {
-			node->set_twin(twin);
+			other = n->get_twin();
 		}
 };
 
-class ChangeName : public Undoable {
+// the old name is saved by the UndoMachine
+class ChangeName : public UndoEvent {
 	public:
-		Node *node;
-		string name;
-
 		ChangeName(Node *n) {
+			type = UNDO_CHANGE_NAME;
 			node = n;
-			name = n->get_name();//str();
-//			name = n->str();
-		}
-
-		void undo() {
-			node->set_name(name);
 		}
 };
 
-class ChangeEdgePreInterval : public Undoable {
+class ChangeEdgePreInterval : public UndoEvent {
 	public:
-		Node *node;
-		int start;
-		int end;
-
 		ChangeEdgePreInterval(Node *n) {
-			start = n->get_edge_pre_start();
-			end = n->get_edge_pre_end();
+			type = UNDO_CHANGE_EDGE_PRE_INTERVAL;
 			node = n;
-		}
-
-		void undo() {
-			node->set_edge_pre_start(start);
-			node->set_edge_pre_end(end);
+			x = n->get_edge_pre_start();
+			y = n->get_edge_pre_end();
 		}
 };
 
-class ChangePreNum : public Undoable {
+class ChangePreNum : public UndoEvent {
 	public:
-		Node *node;
-		int prenum;
-
 		ChangePreNum(Node *n) {
-			prenum = n->get_preorder_number();
+			type = UNDO_CHANGE_PRE_NUM;
 			node = n;
-		}
-
-		void undo() {
-			node->set_preorder_number(prenum);
+			x = n->get_preorder_number();
 		}
 };
 
-class ChangeRightChild : public Undoable {
+// other is the old child and x its depth
+class ChangeRightChild : public UndoEvent {
 	public:
-		Node *node;
-		Node *rchild;
-		int rchild_depth;
-
 		ChangeRightChild(Node *n) {
+			type = UNDO_CHANGE_RIGHT_CHILD;
 			node = n;
-			rchild = n->rchild();
-			if (rchild != NULL)
-				rchild_depth = rchild->get_depth();
-		}
-
-		void undo() {
-			if (rchild != NULL) {
-				//node->add_child_keep_depth(rchild);
-				node->add_child(rchild);
-				rchild->set_depth(rchild_depth);
-			}
-			else
-				if (node->rchild() != NULL)
-					node->rchild()->cut_parent();
+			other = n->rchild();
+			if (other != NULL)
+				x = other->get_depth();
 		}
 };
 
-class ChangeLeftChild : public Undoable {
+class ChangeLeftChild : public UndoEvent {
 	public:
-		Node *node;
-		Node *lchild;
-		int lchild_depth;
-
 		ChangeLeftChild(Node *n) {
+			type = UNDO_CHANGE_LEFT_CHILD;
 			node = n;
-			lchild = n->lchild();
-			if (lchild != NULL)
-				lchild_depth = lchild->get_depth();
-		}
-
-		void undo() {
-			if (lchild != NULL) {
-				//node->add_child_keep_depth(lchild);
-				node->add_child(lchild);
-				lchild->set_depth(lchild_depth);
-			}
-			else
-				if (node->lchild() != NULL)
-					node->lchild()->cut_parent();
+			other = n->lchild();
+			if (other != NULL)
+				x = other->get_depth();
 		}
 };
 
-class AddChild : public Undoable {
+class AddChild : public UndoEvent {
 	public:
-		Node *child;
-		int depth;
-
 		AddChild(Node *c) {
-			child = c;
+			type = UNDO_ADD_CHILD;
+			node = c;
 			if (c != NULL)
-				depth = c->get_depth();
-		}
-
-		void undo() {
-			if (child != NULL) {
-				child->cut_parent();
-				child->set_depth(depth);
-			}
+				x = c->get_depth();
 		}
 };
 
-class AddContractedLC : public Undoable {
+class AddContractedLC : public UndoEvent {
 	public:
-		Node *node;
-
 		AddContractedLC(Node *n) {
+			type = UNDO_ADD_CONTRACTED_LC;
 			node = n;
 		}
-
-		void undo() {
-			node->set_contracted_lc(NULL);
-		}
 };
 
-class AddContractedRC : public Undoable {
+class AddContractedRC : public UndoEvent {
 	public:
-		Node *node;
-
 		AddContractedRC(Node *n) {
+			type = UNDO_ADD_CONTRACTED_RC;
 			node = n;
 		}
-
-		void undo() {
-			node->set_contracted_rc(NULL);
-		}
 };
 
-class CreateNode : public Undoable {
+class CreateNode : public UndoEvent {
 	public:
-		Node *node;
-
 		CreateNode(Node *n) {
+			type = UNDO_CREATE_NODE;
 			node = n;
 		}
-
-		void undo() {
-			if (node != NULL)
-				delete node;
-		}
 };
 
-class ProtectEdge : public Undoable {
+class ProtectEdge : public UndoEvent {
 	public:
-		Node *node;
-
 		ProtectEdge(Node *n) {
+			type = UNDO_PROTECT_EDGE;
 			node = n;
 		}
-
-		void undo() {
-			if (node != NULL)
-				node->unprotect_edge();
-		}
 };
 
-class UnprotectEdge : public Undoable {
+class UnprotectEdge : public UndoEvent {
 	public:
-		Node *node;
-
 		UnprotectEdge(Node *n) {
+			type = UNDO_UNPROTECT_EDGE;
 			node = n;
 		}
-
-		void undo() {
-			if (node != NULL)
-				node->protect_edge();
-		}
 };
 
-class ListPushBack : public Undoable {
+class ListPushBack : public UndoEvent {
 	public:
-		list<Node *> *l;
-
-		ListPushBack(list<Node *> *x) {
-			l = x;
-		}
-
-		void undo() {
-			l->pop_back();
+		ListPushBack(list<Node *> *l) {
+			type = UNDO_LIST_PUSH_BACK;
+			container = l;
 		}
 };
 
-class ListPopBack : public Undoable {
+class ListPopBack : public UndoEvent {
 	public:
-		list<Node *> *l;
-		Node *node;
-
-		ListPopBack(list<Node *> *x) {
-			l = x;
+		ListPopBack(list<Node *> *l) {
+			type = UNDO_LIST_POP_BACK;
+			container = l;
 			if (!l->empty())
 				node = l->back();
 			else
 				node = NULL;
 		}
-
-		void undo() {
-			if (node != NULL)
-				l->push_back(node);
-		}
 };
 
 
-void ContractEvent(UndoMachine *um, Node *n, list<Undoable *>::iterator
-		bookmark) {
-		Node *parent = n->parent();
-		Node *child;
-		Node *lc = n->lchild();
-		Node *rc = n->rchild();
-		Node *ret = NULL;
-		// contract out this node and give child to parent
-		if (parent != NULL) {
-			if (lc && !rc) {
-				child = lc;
-				um->add_event(new ChangeEdgePreInterval(child));
-				um->add_event(new CutParent(child));
-				um->add_event(new CutParent(n));
-				if (n->is_protected() && !child->is_protected())
-					um->add_event(new ProtectEdge(child));
-			}
-			else if (rc && !lc) {
-				child = rc;
-				um->add_event(new ChangeEdgePreInterval(child));
-				um->add_event(new CutParent(child));
-				um->add_event(new CutParent(n));
-				if (n->is_protected() && !child->is_protected())
-					um->add_event(new ProtectEdge(child));
-			}
-			else if (lc == NULL && rc == NULL) {
-				um->insert_event(bookmark, new CutParent(n));
-				parent->delete_child(n);
-				ContractEvent(um, parent);
-				parent->add_child(n);
-			}
-		}
-		// if no parent then take children of single child and remove it
-		else {
-
-			// dead component or singleton, will be cleaned up by the forest
-			if (n->get_children().empty()) {
-				um->add_event(new ChangeName(n));
-			}
-			else if (n->get_children().size() == 1) {
-				child = n->get_children().front();
-//				if (rc == NULL) {
-//					um->add_event(new ChangeRightChild(n));
-//					child = lc;
-//				}
-//				else {
-//					um->add_event(new ChangeLeftChild(n));
-//					child = rc;
-//				}
-				um->add_event(new CutParent(child));
-				/* cluster hack - if we delete a cluster node then
-				 * we may try to use it later. This only happens once
-				 * per cluster so we can spend linear time to update
-				 * the forest
-				 */
-				if (child->get_num_clustered_children() > 0) {
-					//um->add_event(new CutParent(n));
-				}
-				else {
-					// if child is a leaf then get rid of this so we don't lose refs
-					// problem: if the child is not c, then we want to copy
-					// otherwise we don't
-					// copy other parameters and join the twin
-					//to this if the child is a label
-
-					Node *new_lc = child->lchild();
-					Node *new_rc = child->rchild();
-					if (child->is_leaf()) {
-						if (child->get_twin() != NULL) {
-							um->add_event(new SetTwin(n));
-							um->add_event(new SetTwin(child->get_twin()));
-						}
-						um->add_event(new ChangeName(n));
-					}
-					um->add_event(new ChangePreNum(n));
-					//um->add_event(new CutParent(n));
-					list<Node *>::iterator c;
-					for(c = child->get_children().begin();
-							c != child->get_children().end();
-							c++) {
-						um->add_event(new CutParent(*c));
-					}
-					if (child->get_contracted_lc() != NULL)
-						um->add_event(new AddContractedLC(n));
-					if (child->get_contracted_rc() != NULL)
-						um->add_event(new AddContractedRC(n));
-				}
-			}
-		}
-
-	}
-
-void ContractEvent(UndoMachine *um, Node *n) {
-	list<Undoable *>::iterator bookmark = um->get_bookmark();
-	ContractEvent(um, n, bookmark);
-}
+void ContractEvent(UndoMachine *um, Node *n, int bookmark);
 
 #endif
@@ -0,0 +1,414 @@
+/*******************************************************************************
+benchmark.cpp
+
+Reproducible performance workloads for the neighborhood tools and rspr
+
+Copyright 2014 Chris Whidden
+cwhidden@fhcrc.org
+Version 0.0.1
+
+This file is part of spr_neighbors
+
+spr_neighbors is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+spr_neighbors is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with spr_neighbors.  If not, see <http://www.gnu.org/licenses/>.
+
+*******************************************************************************/
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cstring>
+#include <climits>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <list>
+#include <random>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "Forest.h"
+#include "spr_journal.h"
+
+using namespace std;
+
+// OPTIONS
+bool QUICK = false;
+unsigned int SEED = 1;
+
+// USAGE
+string USAGE =
+"benchmark, version 0.0.1\n"
+"\n"
+"Run each workload as a separate process and print one JSON object per\n"
+"line with its wall time, throughput and peak resident set size. Run from\n"
+"the source directory after make bench builds the tools.\n"
+"\n"
+"Workloads:\n"
+"  neighbors   spr_neighbors k = 1..3 on random and caterpillar trees\n"
+"  dense_graph spr_dense_graph on graphs/1_tube_candidates_*\n"
+"  1_tube      1_tube on graphs/graph_ds1_candidates_*\n"
+"  rspr        rspr -total on trees at 3, 6 and 9 random SPR moves from a\n"
+"              random tree, with the solver's per-phase timing\n"
+"\n"
+"--quick    Only the smallest size of each workload\n"
+"--seed x   Seed for the generated trees (default 1)\n"
+"--help     Print this message\n";
+
+// the outcome of running one workload process
+struct BenchRun {
+	double seconds;
+	long peak_rss_kb;
+	int status;
+};
+
+// FUNCTIONS
+
+double wall_time() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* run args with stdin from in_file and stdout to out_file and
+	 measure it
+*/
+BenchRun run_process(vector<string> &args, const string &in_file,
+		const string &out_file) {
+	BenchRun result;
+	result.seconds = 0;
+	result.peak_rss_kb = 0;
+	result.status = -1;
+	double start = wall_time();
+	pid_t pid = fork();
+	if (pid < 0)
+		return result;
+	if (pid == 0) {
+		int in = open(in_file.c_str(), O_RDONLY);
+		int out = open(out_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (in < 0 || out < 0)
+			_exit(127);
+		dup2(in, 0);
+		dup2(out, 1);
+		vector<char *> argv = vector<char *>();
+		for(int i = 0; i < args.size(); i++)
+			argv.push_back((char *)args[i].c_str());
+		argv.push_back(NULL);
+		execvp(argv[0], &argv[0]);
+		_exit(127);
+	}
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) < 0)
+		return result;
+	result.seconds = wall_time() - start;
+	result.peak_rss_kb = usage.ru_maxrss;
+	result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	return result;
+}
+
+string read_file(const string &file) {
+	ifstream in(file.c_str());
+	stringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+int count_lines(const string &file) {
+	ifstream in(file.c_str());
+	string line;
+	int lines = 0;
+	while (getline(in, line)) {
+		if (!line.empty())
+			lines++;
+	}
+	return lines;
+}
+
+void write_file(const string &file, const string &contents) {
+	ofstream out(file.c_str());
+	out << contents;
+}
+
+/* print a workload's measurements as a JSON object. extra holds any
+	 further "key": value pairs, without a leading comma
+*/
+void report(const string &workload, const string &params, long items,
+		BenchRun &run, const string &extra) {
+	cout << "{\"workload\": \"" << workload << "\"";
+	cout << ", \"params\": \"" << params << "\"";
+	cout << ", \"status\": " << run.status;
+	cout << ", \"seconds\": " << run.seconds;
+	cout << ", \"items\": " << items;
+	cout << ", \"items_per_second\": ";
+	if (run.seconds > 0)
+		cout << items / run.seconds;
+	else
+		cout << 0;
+	cout << ", \"peak_rss_kb\": " << run.peak_rss_kb;
+	if (!extra.empty())
+		cout << ", " << extra;
+	cout << "}" << endl;
+}
+
+// a random binary tree on leaves 1..n, joining random pairs
+Node *random_tree(int n, mt19937 &rng) {
+	vector<Node *> nodes = vector<Node *>();
+	for(int i = 1; i <= n; i++) {
+		stringstream ss;
+		ss << i;
+		nodes.push_back(new Node(ss.str()));
+	}
+	while (nodes.size() > 1) {
+		int a = rng() % nodes.size();
+		Node *x = nodes[a];
+		nodes.erase(nodes.begin() + a);
+		int b = rng() % nodes.size();
+		Node *y = nodes[b];
+		nodes.erase(nodes.begin() + b);
+		Node *p = new Node();
+		p->add_child(x);
+		p->add_child(y);
+		nodes.push_back(p);
+	}
+	return nodes[0];
+}
+
+// the caterpillar (1,(2,(3,...(n-1,n))))
+Node *caterpillar_tree(int n) {
+	stringstream ss;
+	ss << n;
+	Node *tree = new Node(ss.str());
+	for(int i = n - 1; i >= 1; i--) {
+		stringstream si;
+		si << i;
+		Node *p = new Node();
+		p->add_child(new Node(si.str()));
+		p->add_child(tree);
+		tree = p;
+	}
+	return tree;
+}
+
+/* root tree at a random one of its rootings, found by passing the
+	 unrooted tree through gen_rooted_trees.pl. Returns the tree unchanged
+	 if the script fails
+*/
+string random_rooting(Node *tree, const string &dir, mt19937 &rng) {
+	string rooted = tree->str_subtree();
+	if (tree->get_children().size() != 2)
+		return rooted;
+	// join the root's children into an unrooted (A,B,C) tree
+	Node *l = tree->lchild();
+	Node *r = tree->rchild();
+	string unrooted;
+	if (!r->is_leaf())
+		unrooted = "(" + l->str_subtree() + ","
+				+ r->lchild()->str_subtree() + ","
+				+ r->rchild()->str_subtree() + ");";
+	else if (!l->is_leaf())
+		unrooted = "(" + r->str_subtree() + ","
+				+ l->lchild()->str_subtree() + ","
+				+ l->rchild()->str_subtree() + ");";
+	else
+		return rooted;
+	string in_file = dir + "/unrooted";
+	string out_file = dir + "/rootings";
+	write_file(in_file, unrooted + "\n");
+	vector<string> args = vector<string>();
+	args.push_back("perl");
+	args.push_back("./gen_rooted_trees.pl");
+	BenchRun run = run_process(args, in_file, out_file);
+	if (run.status != 0)
+		return rooted;
+	vector<string> rootings = vector<string>();
+	ifstream in(out_file.c_str());
+	string line;
+	while (getline(in, line)) {
+		if (!line.empty()) {
+			line.erase(line.find_last_not_of(";") + 1);
+			rootings.push_back(line);
+		}
+	}
+	if (rootings.empty())
+		return rooted;
+	return rootings[rng() % rootings.size()];
+}
+
+// apply num_moves random SPR moves to a copy of tree
+string random_spr_moves(Node *tree, int num_moves, mt19937 &rng) {
+	Node *copy = new Node(*tree);
+	string moved;
+	{
+		SPRJournal journal = SPRJournal(copy);
+		for(int i = 0; i < num_moves; ) {
+			vector<Node *> nodes = journal.root()->find_descendants();
+			Node *n = nodes[rng() % nodes.size()];
+			Node *t = nodes[rng() % nodes.size()];
+			if (journal.apply(n, t))
+				i++;
+		}
+		moved = journal.root()->str_subtree();
+	}
+	copy->delete_tree();
+	return moved;
+}
+
+void bench_neighbors(const string &dir, mt19937 &rng) {
+	// sizes for k = 1, 2, 3
+	int sizes[3][3] = {{16, 32, 48}, {8, 10, 12}, {6, 7, 8}};
+	int num_sizes = QUICK ? 1 : 3;
+	for(int shape = 0; shape < 2; shape++) {
+		for(int k = 1; k <= 3; k++) {
+			for(int s = 0; s < num_sizes; s++) {
+				int n = sizes[k-1][s];
+				Node *tree;
+				if (shape == 0)
+					tree = random_tree(n, rng);
+				else
+					tree = caterpillar_tree(n);
+				string rooted = random_rooting(tree, dir, rng);
+				tree->delete_tree();
+				string in_file = dir + "/tree";
+				string out_file = dir + "/out";
+				write_file(in_file, rooted + ";\n");
+				vector<string> args = vector<string>();
+				args.push_back("./spr_neighbors");
+				args.push_back("-k");
+				stringstream ks;
+				ks << k;
+				args.push_back(ks.str());
+				args.push_back("--size_only");
+				BenchRun run = run_process(args, in_file, out_file);
+				long trees = atol(read_file(out_file).c_str());
+				stringstream params;
+				params << (shape == 0 ? "random" : "caterpillar") << " n=" << n
+						<< " k=" << k;
+				report("neighbors", params.str(), trees, run, "");
+			}
+		}
+	}
+}
+
+void bench_dense_graph(const string &dir) {
+	string in_file = "graphs/1_tube_candidates_ds1_peaks_trimmed_min_minusone_numbered";
+	string out_file = dir + "/out";
+	vector<string> args = vector<string>();
+	args.push_back("./spr_dense_graph");
+	BenchRun run = run_process(args, in_file, out_file);
+	stringstream extra;
+	extra << "\"edges\": " << count_lines(out_file);
+	report("dense_graph", "1_tube_candidates", count_lines(in_file), run,
+			extra.str());
+}
+
+void bench_1_tube(const string &dir) {
+	string in_file = "graphs/graph_ds1_candidates_ds1_peaks_trimmed_min_minusone";
+	string out_file = dir + "/out";
+	int ks[3] = {1, 2, 3};
+	int num_ks = QUICK ? 1 : 3;
+	for(int i = 0; i < num_ks; i++) {
+		vector<string> args = vector<string>();
+		args.push_back("./1_tube");
+		stringstream ks_str;
+		ks_str << ks[i];
+		args.push_back(ks_str.str());
+		args.push_back("0");
+		args.push_back("1");
+		BenchRun run = run_process(args, in_file, out_file);
+		stringstream params;
+		params << "graph_ds1 k=" << ks[i];
+		report("1_tube", params.str(), count_lines(in_file), run, "");
+	}
+}
+
+void bench_rspr(const string &dir, mt19937 &rng) {
+	int moves[3] = {3, 6, 9};
+	int num_moves = QUICK ? 1 : 3;
+	int n = 50;
+	int num_trees = 10;
+	for(int m = 0; m < num_moves; m++) {
+		Node *tree = random_tree(n, rng);
+		stringstream trees;
+		trees << tree->str_subtree() << ";" << endl;
+		for(int i = 0; i < num_trees; i++)
+			trees << random_spr_moves(tree, moves[m], rng) << ";" << endl;
+		tree->delete_tree();
+		string in_file = dir + "/trees";
+		string out_file = dir + "/out";
+		string stats_file = dir + "/stats";
+		write_file(in_file, trees.str());
+		write_file(stats_file, "");
+		vector<string> args = vector<string>();
+		args.push_back("./rspr");
+		args.push_back("-total");
+		args.push_back("-solver_stats");
+		args.push_back(stats_file);
+		BenchRun run = run_process(args, in_file, out_file);
+		string stats = read_file(stats_file);
+		stats.erase(stats.find_last_not_of("\n") + 1);
+		if (stats.empty())
+			stats = "{}";
+		stringstream params;
+		params << "n=" << n << " moves=" << moves[m];
+		report("rspr", params.str(), num_trees, run, "\"phases\": " + stats);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int max_args = argc-1;
+	while (argc > 1) {
+		char *arg = argv[--argc];
+		if (strcmp(arg, "--quick") == 0) {
+			QUICK = true;
+		}
+		else if (strcmp(arg, "--seed") == 0) {
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					SEED = atoi(arg2);
+			}
+		}
+		else if (strcmp(arg, "--help") == 0) {
+			cout << USAGE;
+			return 0;
+		}
+	}
+
+	char dir_template[] = "/tmp/rspr_bench_XXXXXX";
+	char *dir = mkdtemp(dir_template);
+	if (dir == NULL) {
+		cerr << "could not create a temporary directory" << endl;
+		return 1;
+	}
+	mt19937 rng(SEED);
+
+	bench_neighbors(dir, rng);
+	bench_dense_graph(dir);
+	bench_1_tube(dir);
+	bench_rspr(dir, rng);
+
+	const char *files[] = {"unrooted", "rootings", "tree", "trees", "out",
+			"stats"};
+	for(int i = 0; i < 6; i++)
+		unlink((string(dir) + "/" + files[i]).c_str());
+	rmdir(dir);
+	return 0;
+}
@@ -348,6 +348,7 @@ Node *find_best_target(Node *source, Node *target, Node **best_target) {
 			c != target->get_children().end(); c++) {
 		find_best_target(source, *c, best_target);
 	}
+	return *best_target;
 }
 
 void add_lcas_to_groups(vector<int> *pre_to_group, Node *subtree) {
@@ -39,6 +39,13 @@ These options control what algorithm is used
 -bb         Calculate the exact rSPR distance with a branch-and-bound
             FPT algorithm. This is the default option.
 
+-parallel_bb x   Search the top x levels (default 3) of the branch-and-bound
+                 in parallel with OpenMP tasks. Has no effect with one
+                 thread
+
+-parallel_clusters   Solve independent clusters of the cluster reduction in
+                     parallel
+
 -approx		Calculate just a linear -time 3-approximation of the rSPR distance
 
 -cluster_test   Use the cluster reduction to speed up the exact algorithm.
@@ -66,6 +73,10 @@ just that subset of optimizations. See the README for more information.
 
 -sc			Use "separate components" improved branching
 
+-memoize x  Remember the solutions of up to x (default 100000) cluster
+            subproblems and reuse them when the same cluster recurs, e.g.
+            in the gene trees of a -pairwise or -total run
+
 *******************************************************************************
 UNROOTED COMPARISON OPTIONS
 *******************************************************************************
@@ -97,6 +108,21 @@ PAIRWISE COMPARISON OPTIONS
                          Larger values are output as -1. Very efficient for
                          small distances (e.g. 1-10).
 
+-pairwise_threshold x    Use with -pairwise to only decide whether each
+                         distance is at most x. Bounds from the
+                         3-approximation resolve most pairs and an exact
+                         search is run only when they straddle x. Exact
+                         distances are output as d and others as lower:upper.
+
+-pairwise_matrix         Use with -pairwise to output the full symmetric
+                         matrix. Each pair is computed once, the slowest
+                         (by approximate distance) first, with dynamic load
+                         balancing across threads.
+
+-checkpoint f            Use with -pairwise_matrix to save each distance to
+                         the file f as it is found. Rerunning with the same
+                         file resumes an interrupted run.
+
 *******************************************************************************
 OTHER OPTIONS
 *******************************************************************************
@@ -104,6 +130,15 @@ OTHER OPTIONS
             algorithm
 
 -q          Quiet; Do not output the input trees or approximation
+
+-cache f    Keep the exact distances and bounds found in the file f and
+            reuse them in later runs. Used by -total and -pairwise
+
+-solver_stats f
+            Write solver statistics as JSON to the file f, or to stderr if
+            no file is given: branch-and-bound nodes by k, approximation
+            prunes, undo events, clusters, memo hits and the time spent
+            syncing, approximating and searching
 *******************************************************************************
 
 Example:
@@ -168,6 +203,11 @@ int PAIRWISE_COL_START = 0;
 int PAIRWISE_COL_END = INT_MAX;
 bool PAIRWISE_MAX = false;
 int PAIRWISE_MAX_SPR = INT_MAX;
+bool PAIRWISE_MATRIX = false;
+int PAIRWISE_THRESHOLD = -1;
+string CHECKPOINT_FILE = "";
+bool STATS = false;
+string STATS_FILE = "";
 bool APPROX = false;
 bool LOWER_BOUND = false;
 bool REDUCE_ONLY = false;
@@ -175,6 +215,7 @@ bool PRINT_ROOTED_TREES = false;
 bool SHOW_MOVES = false;
 bool SEQUENCE = false;
 int MULTI_TEST = 0;
+string CACHE_FILE = "";
 
 string USAGE =
 "rspr, version 1.2.2\n"
@@ -206,6 +247,13 @@ string USAGE =
 "-bb         Calculate the exact rSPR distance with a branch-and-bound\n"
 "            FPT algorithm. This is the default option.\n"
 "\n"
+"-parallel_bb x   Search the top x levels (default 3) of the branch-and-bound\n"
+"                 in parallel with OpenMP tasks. Has no effect with one\n"
+"                 thread\n"
+"\n"
+"-parallel_clusters   Solve independent clusters of the cluster reduction in\n"
+"                     parallel\n"
+"\n"
 "-approx     Calculate just a linear -time 3-approximation of the\n"
 "            rSPR distance\n"
 "\n"
@@ -234,6 +282,10 @@ string USAGE =
 "\n"
 "-sc         Use \"separate components\" improved branching\n"
 "\n"
+"-memoize x  Remember the solutions of up to x (default 100000) cluster\n"
+"            subproblems and reuse them when the same cluster recurs, e.g.\n"
+"            in the gene trees of a -pairwise or -total run\n"
+"\n"
 "*******************************************************************************\n"
 "UNROOTED COMPARISON OPTIONS\n"
 "*******************************************************************************\n"
@@ -266,6 +318,21 @@ string USAGE =
 "                         Larger values are output as -1. Very efficient for\n"
 "                         small distances (e.g. 1-10).\n"
 "\n"
+"-pairwise_threshold x    Use with -pairwise to only decide whether each\n"
+"                         distance is at most x. Bounds from the\n"
+"                         3-approximation resolve most pairs and an exact\n"
+"                         search is run only when they straddle x. Exact\n"
+"                         distances are output as d and others as lower:upper.\n"
+"\n"
+"-pairwise_matrix         Use with -pairwise to output the full symmetric\n"
+"                         matrix. Each pair is computed once, the slowest\n"
+"                         (by approximate distance) first, with dynamic load\n"
+"                         balancing across threads.\n"
+"\n"
+"-checkpoint f            Use with -pairwise_matrix to save each distance to\n"
+"                         the file f as it is found. Rerunning with the same\n"
+"                         file resumes an interrupted run.\n"
+"\n"
 "\n"
 "*******************************************************************************\n"
 "OTHER OPTIONS\n"
@@ -274,6 +341,15 @@ string USAGE =
 "            time algorithm\n"
 "\n"
 "-q          Quiet; Do not output the input trees or approximation\n"
+"\n"
+"-cache f    Keep the exact distances and bounds found in the file f and\n"
+"            reuse them in later runs. Used by -total and -pairwise\n"
+"\n"
+"-solver_stats f\n"
+"            Write solver statistics as JSON to the file f, or to stderr if\n"
+"            no file is given: branch-and-bound nodes by k, approximation\n"
+"            prunes, undo events, clusters, memo hits and the time spent\n"
+"            syncing, approximating and searching\n"
 "*******************************************************************************\n";
 
 int main(int argc, char *argv[]) {
@@ -288,9 +364,20 @@ int main(int argc, char *argv[]) {
 			DEFAULT_ALGORITHM=false;
 		}
 		else if (strcmp(arg, "-bb") == 0) {
-			BB = true;
+			rspr_context()->BB = true;
 			DEFAULT_ALGORITHM=false;
 		}
+		else if (strcmp(arg, "-parallel_bb") == 0) {
+			rspr_context()->PARALLEL_BB = true;
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					rspr_context()->PARALLEL_BB_DEPTH = atoi(arg2);
+			}
+		}
+		else if (strcmp(arg, "-parallel_clusters") == 0) {
+			rspr_context()->PARALLEL_CLUSTERS = true;
+		}
 		else if (strcmp(arg, "-approx") == 0) {
 			DEFAULT_ALGORITHM=false;
 			APPROX=true;
@@ -301,34 +388,34 @@ int main(int argc, char *argv[]) {
 			LOWER_BOUND=true;
 		}
 		else if (strcmp(arg, "-fast_approx") == 0) {
-			APPROX_CUT_ONE_B = true;
-			APPROX_CUT_TWO_B = true;
+			rspr_context()->APPROX_CUT_ONE_B = true;
+			rspr_context()->APPROX_CUT_TWO_B = true;
 //			APPROX_CUT_TWO_B_ROOT = true;
-			APPROX_REVERSE_CUT_ONE_B = true;
+			rspr_context()->APPROX_REVERSE_CUT_ONE_B = true;
 //			APPROX_EDGE_PROTECTION = true;
 		}
 		else if (strcmp(arg, "-a_cob") == 0) {
-			APPROX_CUT_ONE_B = true;
+			rspr_context()->APPROX_CUT_ONE_B = true;
 		}
 		else if (strcmp(arg, "-a_c2b") == 0) {
-			APPROX_CUT_TWO_B = true;
+			rspr_context()->APPROX_CUT_TWO_B = true;
 		}
 		else if (strcmp(arg, "-a_c2br") == 0) {
-			APPROX_CUT_TWO_B_ROOT = true;
+			rspr_context()->APPROX_CUT_TWO_B_ROOT = true;
 		}
 		else if (strcmp(arg, "-a_rcob") == 0) {
-			APPROX_REVERSE_CUT_ONE_B = true;
+			rspr_context()->APPROX_REVERSE_CUT_ONE_B = true;
 		}
 		else if (strcmp(arg, "-a_rcob2") == 0) {
-			APPROX_REVERSE_CUT_ONE_B_2 = true;
+			rspr_context()->APPROX_REVERSE_CUT_ONE_B_2 = true;
 		}
 		else if (strcmp(arg, "-a_protection") == 0) {
-			APPROX_EDGE_PROTECTION = true;
+			rspr_context()->APPROX_EDGE_PROTECTION = true;
 		}
 		else if (strcmp(arg, "-q") == 0)
 			QUIET = true;
 		else if (strcmp(arg, "-cc") == 0)
-			APPROX_CHECK_COMPONENT = true;
+			rspr_context()->APPROX_CHECK_COMPONENT = true;
 		else if (strcmp(arg, "-unrooted") == 0)
 			UNROOTED = true;
 		else if (strcmp(arg, "-all_unrooted") == 0) {
@@ -343,58 +430,58 @@ int main(int argc, char *argv[]) {
 		}
 		else if (strcmp(arg, "-simple_unrooted_leaf") == 0) {
 			SIMPLE_UNROOTED = true;
-			SIMPLE_UNROOTED_LEAF = 1;
+			rspr_context()->SIMPLE_UNROOTED_LEAF = 1;
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-')
-					SIMPLE_UNROOTED_LEAF = atoi(arg2);
+					rspr_context()->SIMPLE_UNROOTED_LEAF = atoi(arg2);
 			}
 		}
 		else if (strcmp(arg, "-unrooted_min_approx") == 0)
-			UNROOTED_MIN_APPROX = true;
+			rspr_context()->UNROOTED_MIN_APPROX = true;
 		else if (strcmp(arg, "-noopt") == 0) {
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_one_b") == 0 ||
 				strcmp(arg, "-cob") == 0) {
-			CUT_ONE_B = true;
+			rspr_context()->CUT_ONE_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-reverse_cut_one_b") == 0 ||
 				strcmp(arg, "-rcob") == 0) {
-			REVERSE_CUT_ONE_B = true;
+			rspr_context()->REVERSE_CUT_ONE_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-reverse_cut_one_b_2") == 0 ||
 				strcmp(arg, "-rcob2") == 0) {
-			REVERSE_CUT_ONE_B_2 = true;
+			rspr_context()->REVERSE_CUT_ONE_B_2 = true;
 		}
 		else if (strcmp(arg, "-reverse_cut_one_b_3") == 0 ||
 				strcmp(arg, "-rcob3") == 0) {
-			REVERSE_CUT_ONE_B_3 = true;
+			rspr_context()->REVERSE_CUT_ONE_B_3 = true;
 		}
 		else if (strcmp(arg, "-cut_two_b") == 0 ||
 				strcmp(arg, "-c2b") == 0) {
-			CUT_TWO_B = true;
+			rspr_context()->CUT_TWO_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_two_b_root") == 0 ||
 				strcmp(arg, "-c2br") == 0) {
-			CUT_TWO_B_ROOT = true;
+			rspr_context()->CUT_TWO_B_ROOT = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_all_b") == 0 ||
 				strcmp(arg, "-cab") == 0) {
-			CUT_ALL_B = true;
+			rspr_context()->CUT_ALL_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_ac_separate_components") == 0 ||
 				strcmp(arg, "-sc") == 0) {
-			CUT_AC_SEPARATE_COMPONENTS = true;
+			rspr_context()->CUT_AC_SEPARATE_COMPONENTS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_one_ab") == 0) {
-			CUT_ONE_AB = true;
+			rspr_context()->CUT_ONE_AB = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-h") == 0) {
@@ -405,7 +492,7 @@ int main(int argc, char *argv[]) {
 			LCA_TEST = true;
 		}
 		else if (strcmp(arg, "-find_rate") == 0) {
-			FIND_RATE = true;
+			rspr_context()->FIND_RATE = true;
 		}
 		else if (strcmp(arg, "-reduce") == 0) {
 			REDUCE_ONLY = true;
@@ -428,18 +515,21 @@ int main(int argc, char *argv[]) {
 
 		else if (strcmp(arg, "-cluster_test") == 0) {
 			CLUSTER_TEST = true;
-			PREFER_RHO = true;
+			rspr_context()->PREFER_RHO = true;
 		}
 		else if (strcmp(arg, "-prefer_rho") == 0) {
-			PREFER_RHO = true;
+			rspr_context()->PREFER_RHO = true;
 		}
-/*
 		else if (strcmp(arg, "-memoize") == 0) {
-			MEMOIZE = true;
+			rspr_context()->MEMOIZE = true;
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					rspr_context()->memoized_clusters->set_capacity(atoi(arg2));
+			}
 		}
-*/
 		else if (strcmp(arg, "-all_mafs") == 0) {
-			ALL_MAFS= true;
+			rspr_context()->ALL_MAFS= true;
 		}
 		else if (strcmp(arg, "-total") == 0) {
 			TOTAL= true;
@@ -477,6 +567,34 @@ int main(int argc, char *argv[]) {
 		else if (strcmp(arg, "-no-symmetric-pairwise") == 0) {
 			PAIRWISE_SYMMETRIC=false;
 		}
+		else if (strcmp(arg, "-cache") == 0) {
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					CACHE_FILE = arg2;
+			}
+		}
+		else if (strcmp(arg, "-pairwise_matrix") == 0) {
+			PAIRWISE=true;
+			PAIRWISE_MATRIX=true;
+			QUIET=true;
+		}
+		else if (strcmp(arg, "-solver_stats") == 0) {
+			STATS = true;
+			rspr_context()->COLLECT_STATS = true;
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					STATS_FILE = arg2;
+			}
+		}
+		else if (strcmp(arg, "-checkpoint") == 0) {
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					CHECKPOINT_FILE = arg2;
+			}
+		}
 		else if (strcmp(arg, "-pairwise_max") == 0) {
 			PAIRWISE=true;
 			PAIRWISE_MAX=true;
@@ -488,34 +606,44 @@ int main(int argc, char *argv[]) {
 				}
 			}
 		}
+		else if (strcmp(arg, "-pairwise_threshold") == 0) {
+			PAIRWISE=true;
+			QUIET=true;
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-') {
+					PAIRWISE_THRESHOLD = atoi(arg2);
+				}
+			}
+		}
 		else if (strcmp(arg, "-cluster_tune") == 0) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-') {
-					CLUSTER_TUNE = atoi(arg2);
+					rspr_context()->CLUSTER_TUNE = atoi(arg2);
 				}
 			}
 		}
 		else if (strcmp(arg, "-v") == 0) {
-			VERBOSE=true;
+			rspr_context()->VERBOSE=true;
 		}
 		else if (strcmp(arg, "-max") == 0) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-') {
-					MAX_SPR = atoi(arg2);
-					CLUSTER_MAX_SPR = MAX_SPR;
+					rspr_context()->MAX_SPR = atoi(arg2);
+					rspr_context()->CLUSTER_MAX_SPR = rspr_context()->MAX_SPR;
 				}
 				if (!QUIET) 
-					cout << "MAX_SPR=" << MAX_SPR << endl;
+					cout << "MAX_SPR=" << rspr_context()->MAX_SPR << endl;
 			}
 		}
 		else if (strcmp(arg, "-cmax") == 0) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-')
-					CLUSTER_MAX_SPR = atoi(arg2);
-				cout << "CLUSTER_MAX_SPR=" << CLUSTER_MAX_SPR << endl;
+					rspr_context()->CLUSTER_MAX_SPR = atoi(arg2);
+				cout << "CLUSTER_MAX_SPR=" << rspr_context()->CLUSTER_MAX_SPR << endl;
 			}
 		}
 		else if (strcmp(arg, "-multi_test") == 0) {
@@ -527,18 +655,18 @@ int main(int argc, char *argv[]) {
 			}
 		}
 		else if (strcmp(arg, "-protect_edges") == 0) {
-			EDGE_PROTECTION = true;
-			cout << "EDGE_PROTECTION=" << EDGE_PROTECTION << endl;
+			rspr_context()->EDGE_PROTECTION = true;
+			cout << "EDGE_PROTECTION=" << rspr_context()->EDGE_PROTECTION << endl;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-protect_edges_two_b") == 0) {
-			EDGE_PROTECTION_TWO_B = true;
+			rspr_context()->EDGE_PROTECTION_TWO_B = true;
 //			cout << "EDGE_PROTECTION=" << EDGE_PROTECTION << endl;
 //			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-check_merge_depth") == 0) {
-			CHECK_MERGE_DEPTH = true;
-			cout << "CHECK_MERGE_DEPTH=" << CHECK_MERGE_DEPTH << endl;
+			rspr_context()->CHECK_MERGE_DEPTH = true;
+			cout << "CHECK_MERGE_DEPTH=" << rspr_context()->CHECK_MERGE_DEPTH << endl;
 //			DEFAULT_OPTIMIZATIONS=false;
 		}
 //		else if (strcmp(arg, "-check_fewer_pairs") == 0) {
@@ -546,32 +674,32 @@ int main(int argc, char *argv[]) {
 //			DEFAULT_OPTIMIZATIONS=false;
 //		}
 		else if (strcmp(arg, "-allow_abort") == 0) {
-			ABORT_AT_FIRST_SOLUTION = true;
+			rspr_context()->ABORT_AT_FIRST_SOLUTION = true;
 //			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-preorder_sib_pairs") == 0) {
-			PREORDER_SIBLING_PAIRS = true;
-			NEAR_PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-near_preorder_sib_pairs") == 0) {
-			NEAR_PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-leaf_reduction") == 0) {
-			LEAF_REDUCTION = true;
+			rspr_context()->LEAF_REDUCTION = true;
 		}
 		else if (strcmp(arg, "-leaf_reduction2") == 0) {
-			LEAF_REDUCTION2 = true;
+			rspr_context()->LEAF_REDUCTION2 = true;
 		}
 		else if (strcmp(arg, "-split_approx") == 0) {
-			SPLIT_APPROX = true;
+			rspr_context()->SPLIT_APPROX = true;
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-')
-					SPLIT_APPROX_THRESHOLD = atoi(arg2);
+					rspr_context()->SPLIT_APPROX_THRESHOLD = atoi(arg2);
 			}
-			cout << "SPLIT_APPROX_THRESHOLD=" << SPLIT_APPROX_THRESHOLD
+			cout << "SPLIT_APPROX_THRESHOLD=" << rspr_context()->SPLIT_APPROX_THRESHOLD
 					<< endl;
 		}
 		else if (strcmp(arg, "-support") == 0) {
@@ -584,20 +712,20 @@ int main(int argc, char *argv[]) {
 			}
 		}
 		else if (strcmp(arg, "-prefer_nonbranching") == 0) {
-			PREFER_NONBRANCHING = true;
+			rspr_context()->PREFER_NONBRANCHING = true;
 		}
 		else if (strcmp(arg, "-deepest") == 0) {
-			DEEPEST_ORDER = true;
+			rspr_context()->DEEPEST_ORDER = true;
 		}
 		else if (strcmp(arg, "-deepest_protected") == 0) {
-			DEEPEST_PROTECTED_ORDER = true;
-			DEEPEST_ORDER = true;
+			rspr_context()->DEEPEST_PROTECTED_ORDER = true;
+			rspr_context()->DEEPEST_ORDER = true;
 		}
 		else if (strcmp(arg, "-count_losses") == 0) {
-			COUNT_LOSSES = true;
+			rspr_context()->COUNT_LOSSES = true;
 		}
 		else if (strcmp(arg, "-cut_lost") == 0) {
-			CUT_LOST = true;
+			rspr_context()->CUT_LOST = true;
 		}
 		else if (strcmp(arg, "-multi_cluster") == 0) {
 			MULTI_CLUSTER = true;
@@ -615,29 +743,29 @@ int main(int argc, char *argv[]) {
 			
 	}
 	if (DEFAULT_OPTIMIZATIONS) {
-		CUT_ALL_B=true;
-		CUT_ONE_B = true;
-		REVERSE_CUT_ONE_B = true;
+		rspr_context()->CUT_ALL_B=true;
+		rspr_context()->CUT_ONE_B = true;
+		rspr_context()->REVERSE_CUT_ONE_B = true;
 //		REVERSE_CUT_ONE_B_2 = true;
-		REVERSE_CUT_ONE_B_3 = true;
-		CUT_TWO_B = true;
+		rspr_context()->REVERSE_CUT_ONE_B_3 = true;
+		rspr_context()->CUT_TWO_B = true;
 //		CUT_TWO_B_ROOT = true;
-		CUT_AC_SEPARATE_COMPONENTS = true;
-		EDGE_PROTECTION = true;
-		EDGE_PROTECTION_TWO_B = true;
+		rspr_context()->CUT_AC_SEPARATE_COMPONENTS = true;
+		rspr_context()->EDGE_PROTECTION = true;
+		rspr_context()->EDGE_PROTECTION_TWO_B = true;
 //		CHECK_MERGE_DEPTH = true;
 //		if (ALL_MAFS == false)
 //			ABORT_AT_FIRST_SOLUTION = true;
 //		PREORDER_SIBLING_PAIRS = true;
-		NEAR_PREORDER_SIBLING_PAIRS = true;
-		LEAF_REDUCTION = true;
-		LEAF_REDUCTION2 = true;
-		PREFER_NONBRANCHING = true;
+		rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
+		rspr_context()->LEAF_REDUCTION = true;
+		rspr_context()->LEAF_REDUCTION2 = true;
+		rspr_context()->PREFER_NONBRANCHING = true;
 
-		APPROX_CUT_ONE_B = true;
-		APPROX_CUT_TWO_B = true;
+		rspr_context()->APPROX_CUT_ONE_B = true;
+		rspr_context()->APPROX_CUT_TWO_B = true;
 //		APPROX_CUT_TWO_B_ROOT = true;
-		APPROX_REVERSE_CUT_ONE_B = true;
+		rspr_context()->APPROX_REVERSE_CUT_ONE_B = true;
 /* BUGGY: we aren't guaranteed that the protected edges mean
 	 anything because we may cut off the only things that can merge with
 	 them. It might make sense to cut a protected edge because it should
@@ -645,17 +773,17 @@ int main(int argc, char *argv[]) {
 */
 
 //		APPROX_EDGE_PROTECTION = true;
-			DEEPEST_PROTECTED_ORDER = true;
-			DEEPEST_ORDER = true;
-		if (CLUSTER_TUNE == -1) {
-			CLUSTER_TUNE = 30;
+			rspr_context()->DEEPEST_PROTECTED_ORDER = true;
+			rspr_context()->DEEPEST_ORDER = true;
+		if (rspr_context()->CLUSTER_TUNE == -1) {
+			rspr_context()->CLUSTER_TUNE = 30;
 		}
 	}
-	PREORDER_SIBLING_PAIRS = true;
+	rspr_context()->PREORDER_SIBLING_PAIRS = true;
 	if (DEFAULT_ALGORITHM) {
-		BB=true;
+		rspr_context()->BB=true;
 		CLUSTER_TEST = true;
-		PREFER_RHO = true;
+		rspr_context()->PREFER_RHO = true;
 	}
 
 	// arguments that imply quiet
@@ -667,11 +795,21 @@ int main(int argc, char *argv[]) {
 	map<string, int> label_map= map<string, int>();
 	map<int, string> reverse_label_map = map<int, string>();
 
+	DistanceCache distance_cache = DistanceCache();
+	if (CACHE_FILE != "") {
+		if (distance_cache.open(CACHE_FILE)) {
+			distance_cache.set_labels(&reverse_label_map);
+			rspr_context()->DISTANCE_CACHE = &distance_cache;
+		}
+		else
+			cerr << "could not open cache file " << CACHE_FILE << endl;
+	}
+
 	// set random seed
 	srand(unsigned(time(0)));
 
 	// Normal operation
-	if (!UNROOTED && !UNROOTED_MIN_APPROX && !TOTAL && !PAIRWISE && !SEQUENCE) {
+	if (!UNROOTED && !rspr_context()->UNROOTED_MIN_APPROX && !TOTAL && !PAIRWISE && !SEQUENCE) {
 		string T1_line = "";
 		string T2_line = "";
 		while (getline(cin, T1_line) && getline(cin, T2_line)) {
@@ -770,7 +908,7 @@ int main(int argc, char *argv[]) {
 			// APPROX ALGORITHM
 			int approx_spr = rSPR_worse_3_approx(&F1, &F2);
 			int min_spr = approx_spr / 3;
-			if (!(QUIET && (BB || FPT))) {
+			if (!(QUIET && (rspr_context()->BB || FPT))) {
 				F1.numbers_to_labels(&reverse_label_map);
 				F2.numbers_to_labels(&reverse_label_map);
 				cout << "approx F1: ";
@@ -821,7 +959,7 @@ int main(int argc, char *argv[]) {
 			}
 			*/
 		
-			if (BB || FPT) {
+			if (rspr_context()->BB || FPT) {
 				// BRANCH AND BOUND FPT ALGORITHM
 				Forest F1 = Forest(F3);
 				Forest F2 = Forest(F4);
@@ -862,7 +1000,7 @@ int main(int argc, char *argv[]) {
 		}
 	}
 	// Comparison between a rooted tree and all rootings of an unrooted tree
-	else if (!TOTAL && !PAIRWISE && !SEQUENCE && (UNROOTED || UNROOTED_MIN_APPROX)) {
+	else if (!TOTAL && !PAIRWISE && !SEQUENCE && (UNROOTED || rspr_context()->UNROOTED_MIN_APPROX)) {
 		string line = "";
 		vector<Forest> trees = vector<Forest>();
 		if (!getline(cin, line))
@@ -901,7 +1039,7 @@ int main(int argc, char *argv[]) {
 				min_spr = approx_spr[i];
 				min_i = i;
 			}
-			if (!(QUIET && (BB || FPT)) && !UNROOTED_MIN_APPROX) {
+			if (!(QUIET && (rspr_context()->BB || FPT)) && !rspr_context()->UNROOTED_MIN_APPROX) {
 				F3.numbers_to_labels(&reverse_label_map);
 				F4.numbers_to_labels(&reverse_label_map);
 				cout << "F1: ";
@@ -913,7 +1051,7 @@ int main(int argc, char *argv[]) {
 			}
 		}
 		// Choose a rooting with minimum approximate distance
-		if (UNROOTED_MIN_APPROX) {
+		if (rspr_context()->UNROOTED_MIN_APPROX) {
 			Forest min_approx_forest = trees[min_i];
 			trees.clear();
 			trees.push_back(min_approx_forest);
@@ -933,9 +1071,9 @@ int main(int argc, char *argv[]) {
 		min_spr /= 3;
 
 		int k, exact_spr;
-		if (FPT || BB) {
+		if (FPT || rspr_context()->BB) {
 			// BRANCH AND BOUND FPT ALGORITHM
-			for(k = min_spr; k <=MAX_SPR;  k++) {
+			for(k = min_spr; k <=rspr_context()->MAX_SPR;  k++) {
 				cout << k << " ";
 				cout.flush();
 				for (int i = 0; i < trees.size(); i++) {
@@ -1018,8 +1156,10 @@ int main(int argc, char *argv[]) {
 			// reroot the gene trees based on the balanced accuracy of splits
 			T1->preorder_number();
 			int end = trees.size();
+			RsprContext *context = rspr_context();
 			#pragma omp parallel for
 			for(int i = 0; i < end; i++) {
+				RsprContextCopy thread_context(context);
 				trees[i]->preorder_number();
 				Node *new_root;
 				if (SIMPLE_UNROOTED_RSPR)
@@ -1056,7 +1196,7 @@ int main(int argc, char *argv[]) {
 
 			int distance;
 
-			if (VERBOSE) {
+			if (rspr_context()->VERBOSE) {
 				T1->numbers_to_labels(&reverse_label_map);
 				cout << "T1: " <<  T1->str_subtree() << endl;
 				T1->labels_to_numbers(&label_map, &reverse_label_map);
@@ -1150,6 +1290,26 @@ int main(int argc, char *argv[]) {
 			end_j = trees.size();
 		}
 
+		if (PAIRWISE_THRESHOLD >= 0 && !RF) {
+			for(int i = start_i; i < end_i; i++) {
+				int j = start_j;
+				if (PAIRWISE_SYMMETRIC) {
+					for(j = start_j; j < i && j < end_j; j++) {
+						cout << ",";
+					}
+				}
+				rSPR_pairwise_distance_bounds(trees[i], trees, PAIRWISE_THRESHOLD,
+						j, end_j, UNROOTED);
+			}
+		}
+		else if (PAIRWISE_MATRIX && !RF) {
+			int max_spr = -1;
+			if (PAIRWISE_MAX)
+				max_spr = PAIRWISE_MAX_SPR;
+			rSPR_pairwise_matrix(trees, start_i, end_i, start_j, end_j,
+					UNROOTED, APPROX, max_spr, CHECKPOINT_FILE);
+		}
+		else
 		for(int i = start_i; i < end_i; i++) {
 			int j = start_j;
 			if (PAIRWISE_SYMMETRIC) {
@@ -1362,6 +1522,8 @@ int main(int argc, char *argv[]) {
 		}
 
 	}
+	if (STATS)
+		print_rspr_stats(STATS_FILE);
 	return 0;
 }
 
@@ -0,0 +1,232 @@
+#ifndef INCLUDE_SHAPE_NEIGHBORS
+#define INCLUDE_SHAPE_NEIGHBORS
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <list>
+#include <time.h>
+
+#include "Node.h"
+
+using namespace std;
+
+/*
+	Symmetry-reduced neighborhoods.
+
+	A leaf equivalence maps each (numeric) leaf label to the label of a
+	class representative. Leaves without an entry are their own class.
+	Leaves of a class are treated as interchangeable, so a tree is known
+	only by its shape: the canonical key built bottom-up from sorted child
+	keys, where all leaves of a class have the same key. Relabeling within
+	a class is an automorphism of the SPR (and NNI) graph, so the shapes
+	adjacent to a shape are those of the neighbors of any one tree with
+	that shape, and only one tree per shape is expanded.
+
+	The multiplicity of a shape is the number of distinct labeled trees
+	with that shape: the product of the factorials of the class sizes,
+	divided by the number of class-preserving automorphisms of the shape.
+	That is the product, over every node, of the factorials of the numbers
+	of its children with equal keys, so both are found from the key
+	alone without listing any relabelings.
+*/
+
+// FUNCTIONS
+
+string shape_key(Node *n, map<int, int> *leaf_class);
+string shape_key(Node *n, map<int, int> *leaf_class, vector<int> *symmetries);
+void shape_key_hlpr(Node *n, map<int, int> *leaf_class, string *s,
+		vector<int> *symmetries);
+string labeled_count(Node *n, map<int, int> *leaf_class,
+		vector<int> &symmetries);
+list<Node *> reduce_by_shape(list<Node *> &neighbors,
+		map<int, int> *leaf_class, map<string, string> &multiplicity,
+		set<string> &known_shapes);
+bool read_leaf_equivalence(istream &in, map<string, int> *label_map,
+		map<int, int> *leaf_class);
+void all_leaves_equivalent(Node *tree, map<int, int> *leaf_class);
+
+// canonical string of a tree with leaves replaced by their class and
+// children ordered by their own canonical strings
+string shape_key(Node *n, map<int, int> *leaf_class) {
+	return shape_key(n, leaf_class, NULL);
+}
+
+/* as above, also adding to symmetries the size of each group of two or
+	 more children with equal keys
+*/
+string shape_key(Node *n, map<int, int> *leaf_class, vector<int> *symmetries) {
+	string s = "";
+	shape_key_hlpr(n, leaf_class, &s, symmetries);
+	return s;
+}
+
+void shape_key_hlpr(Node *n, map<int, int> *leaf_class, string *s,
+		vector<int> *symmetries) {
+	if (n->is_leaf()) {
+		int label = atoi(n->get_name().c_str());
+		map<int, int>::iterator c = leaf_class->find(label);
+		if (c != leaf_class->end())
+			label = c->second;
+		stringstream ss;
+		ss << label;
+		*s += ss.str();
+		return;
+	}
+	vector<string> child_keys = vector<string>();
+	list<Node *>::iterator c;
+	for(c = n->get_children().begin(); c != n->get_children().end(); c++) {
+		string child_key = "";
+		shape_key_hlpr(*c, leaf_class, &child_key, symmetries);
+		child_keys.push_back(child_key);
+	}
+	sort(child_keys.begin(), child_keys.end());
+	*s += "(";
+	int equal = 1;
+	for(int i = 0; i < child_keys.size(); i++) {
+		if (i > 0) {
+			*s += ",";
+			if (child_keys[i] == child_keys[i-1])
+				equal++;
+			else
+				equal = 1;
+			if (symmetries != NULL && equal >= 2
+					&& (i+1 == child_keys.size() || child_keys[i+1] != child_keys[i]))
+				symmetries->push_back(equal);
+		}
+		*s += child_keys[i];
+	}
+	*s += ")";
+}
+
+/* the number of distinct labeled trees with the shape of n, as a decimal
+	 string. symmetries are the equal child groups found by shape_key. The
+	 count is kept in base 10^9 digits, least significant first, as it
+	 overflows 64 bits at 21 equivalent leaves
+*/
+string labeled_count(Node *n, map<int, int> *leaf_class,
+		vector<int> &symmetries) {
+	const unsigned long long base = 1000000000ULL;
+	vector<unsigned long long> count = vector<unsigned long long>(1, 1);
+	// class sizes
+	map<int, int> class_size = map<int, int>();
+	vector<Node *> leaves = n->find_leaves();
+	for(int i = 0; i < leaves.size(); i++) {
+		int label = atoi(leaves[i]->get_name().c_str());
+		map<int, int>::iterator c = leaf_class->find(label);
+		if (c != leaf_class->end())
+			class_size[c->second]++;
+	}
+	// multiply by the factorial of each class size
+	map<int, int>::iterator c;
+	for(c = class_size.begin(); c != class_size.end(); c++) {
+		for(int f = 2; f <= c->second; f++) {
+			unsigned long long carry = 0;
+			for(int d = 0; d < count.size(); d++) {
+				unsigned long long x = count[d] * f + carry;
+				count[d] = x % base;
+				carry = x / base;
+			}
+			if (carry > 0)
+				count.push_back(carry);
+		}
+	}
+	/* divide by the factorial of each group size. The count stays whole
+		 as the automorphisms of the shape are a subgroup of the
+		 relabelings within classes
+	*/
+	for(int i = 0; i < symmetries.size(); i++) {
+		for(int f = 2; f <= symmetries[i]; f++) {
+			unsigned long long remainder = 0;
+			for(int d = count.size() - 1; d >= 0; d--) {
+				unsigned long long x = remainder * base + count[d];
+				count[d] = x / f;
+				remainder = x % f;
+			}
+			while (count.size() > 1 && count.back() == 0)
+				count.pop_back();
+		}
+	}
+	stringstream ss;
+	ss << count.back();
+	for(int d = count.size() - 2; d >= 0; d--) {
+		ss.width(9);
+		ss.fill('0');
+		ss << count[d];
+	}
+	return ss.str();
+}
+
+/* collapse a list of labeled neighbors to one representative per
+	 previously unseen shape. The labeled count of each new shape is
+	 recorded in multiplicity, and each is added to known_shapes. All
+	 non-representatives are deleted
+*/
+list<Node *> reduce_by_shape(list<Node *> &neighbors,
+		map<int, int> *leaf_class, map<string, string> &multiplicity,
+		set<string> &known_shapes) {
+	list<Node *> representatives = list<Node *>();
+	list<Node *>::iterator t;
+	for(t = neighbors.begin(); t != neighbors.end(); t++) {
+		vector<int> symmetries = vector<int>();
+		string key = shape_key(*t, leaf_class, &symmetries);
+		if (known_shapes.insert(key).second) {
+			multiplicity[key] = labeled_count(*t, leaf_class, symmetries);
+			representatives.push_back(*t);
+		}
+		else {
+			(*t)->delete_tree();
+		}
+	}
+	return representatives;
+}
+
+/* read a leaf equivalence, one class per line with whitespace separated
+	 labels. The first label on a line that occurs in label_map is the class
+	 representative. Labels not in label_map are ignored. Returns false if
+	 no class was read
+*/
+bool read_leaf_equivalence(istream &in, map<string, int> *label_map,
+		map<int, int> *leaf_class) {
+	string line;
+	while (getline(in, line)) {
+		stringstream ss(line);
+		string label;
+		int representative = -1;
+		while (ss >> label) {
+			map<string, int>::iterator l = label_map->find(label);
+			if (l == label_map->end())
+				continue;
+			if (representative == -1)
+				representative = l->second;
+			(*leaf_class)[l->second] = representative;
+		}
+	}
+	return !leaf_class->empty();
+}
+
+// treat the tree as unlabeled
+void all_leaves_equivalent(Node *tree, map<int, int> *leaf_class) {
+	vector<Node *> leaves = tree->find_leaves();
+	if (leaves.empty())
+		return;
+	int representative = atoi(leaves[0]->get_name().c_str());
+	for(int i = 0; i < leaves.size(); i++) {
+		int label = atoi(leaves[i]->get_name().c_str());
+		(*leaf_class)[label] = representative;
+	}
+}
+
+#endif
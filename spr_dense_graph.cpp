@@ -26,15 +26,23 @@
 #include "node_glom.h"
 #include "spr_neighbors.h"
 #include "nni_neighbors.h"
+#include "unrooted_neighbors.h"
 
 using namespace std;
 
 // OPTIONS
 bool NNI_ONLY = false;
+bool UNROOTED = false;
+bool TBR = false;
 
 // USAGE
 string USAGE =
-"spr_dense_graph, version 0.0.1\n";
+"spr_dense_graph, version 0.0.1\n"
+"\n"
+"--nni       Use NNI moves instead of SPR moves\n"
+"--unrooted  Treat the trees as unrooted and use unrooted moves\n"
+"--tbr       Use unrooted TBR moves (implies --unrooted)\n"
+"--help      Print this message\n";
 
 // MAIN
 
@@ -46,6 +54,13 @@ int main(int argc, char *argv[]) {
 		if (strcmp(arg, "--nni") == 0) {
 			NNI_ONLY = true;
 		}
+		if (strcmp(arg, "--unrooted") == 0) {
+			UNROOTED = true;
+		}
+		if (strcmp(arg, "--tbr") == 0) {
+			TBR = true;
+			UNROOTED = true;
+		}
 		if (strcmp(arg, "--help") == 0) {
 			cout << USAGE;
 			return 0;
@@ -76,7 +91,11 @@ int main(int argc, char *argv[]) {
 		Node *T = build_tree(T_line);
 		T->labels_to_numbers(&label_map, &reverse_label_map);
 		T->normalize_order();
-		trees.insert(make_pair(T->str_subtree(),num_trees));
+		if (UNROOTED)
+			trees.insert(make_pair(unrooted_str(T),num_trees));
+		else
+			trees.insert(make_pair(T->str_subtree(),num_trees));
+		T->delete_tree();
 		num_trees++;
 	}
 
@@ -87,7 +106,16 @@ int main(int argc, char *argv[]) {
 		int num = t->second;
 //		cout << num << ": " << T->str_subtree() << endl;
 		list<Node *> neighbors;
-		if (NNI_ONLY) {
+		if (TBR) {
+			neighbors = get_tbr_neighbors(T);
+		}
+		else if (UNROOTED && NNI_ONLY) {
+			neighbors = get_unrooted_nni_neighbors(T);
+		}
+		else if (UNROOTED) {
+			neighbors = get_unrooted_spr_neighbors(T);
+		}
+		else if (NNI_ONLY) {
 			neighbors = get_nni_neighbors(T);
 		}
 		else {
@@ -0,0 +1,172 @@
+#ifndef INCLUDE_SPR_JOURNAL
+#define INCLUDE_SPR_JOURNAL
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <list>
+
+#include "Node.h"
+
+using namespace std;
+
+/*
+	An apply/revert journal for SPR moves on a single binary tree.
+
+	The tree is hung below a sentinel node so that every real node,
+	including the root, has a parent. An SPR move then never needs a
+	special case for the root: moving a subtree above the root simply
+	regrafts it onto the sentinel's child edge, and pruning a child of
+	the root lets its sibling become the new root. Use root() rather
+	than a saved pointer, since the root node can change with each move.
+
+	Each move is recorded by value with the nodes and child positions
+	needed to restore the exact children order, so reverting a sequence
+	of moves in reverse order gives back the original tree, node for
+	node. No Undoable objects are allocated.
+*/
+
+// CLASSES
+
+// a single recorded move of n to be the sibling of t
+struct SPRMove {
+	Node *n;
+	// old parent of n, reused as the new parent of n and t
+	Node *p;
+	// old sibling of n
+	Node *s;
+	// old grandparent of n
+	Node *g;
+	// new sibling of n
+	Node *t;
+	// old parent of t
+	Node *q;
+	bool p_first;
+	bool n_first;
+	bool t_first;
+};
+
+class SPRJournal {
+	private:
+	Node *sentinel;
+	vector<SPRMove> moves;
+
+	public:
+	SPRJournal(Node *tree) {
+		sentinel = new Node();
+		sentinel->add_child(tree);
+		moves = vector<SPRMove>();
+	}
+
+	// revert any remaining moves and detach the sentinel
+	~SPRJournal() {
+		revert_to(0);
+		Node *tree = root();
+		if (tree != NULL)
+			tree->cut_parent();
+		delete sentinel;
+	}
+
+	Node *root() {
+		return sentinel->lchild();
+	}
+
+	int size() {
+		return moves.size();
+	}
+
+	// is t in the subtree of n
+	bool in_subtree(Node *t, Node *n) {
+		for(Node *x = t; x != NULL; x = x->parent()) {
+			if (x == n)
+				return true;
+		}
+		return false;
+	}
+
+	/* move n to be the sibling of t
+		 returns false and does nothing if the move is invalid or would
+		 not change the tree
+	*/
+	bool apply(Node *n, Node *t) {
+		if (n == NULL || t == NULL || n == sentinel || t == sentinel)
+			return false;
+		Node *p = n->parent();
+		if (p == NULL || p == sentinel || p->get_children().size() != 2)
+			return false;
+		Node *s = n->get_sibling();
+		if (t == n || t == p || t == s || in_subtree(t, n))
+			return false;
+		SPRMove m;
+		m.n = n;
+		m.p = p;
+		m.s = s;
+		m.g = p->parent();
+		m.p_first = (m.g->get_children().front() == p);
+		m.n_first = (p->get_children().front() == n);
+
+		// prune, putting s where p was
+		s->cut_parent();
+		p->cut_parent();
+		if (m.p_first && !m.g->is_leaf())
+			m.g->insert_child(m.g->get_children().front(), s);
+		else
+			m.g->add_child(s);
+
+		// regraft p where t was
+		m.t = t;
+		m.q = t->parent();
+		m.t_first = (m.q->get_children().front() == t);
+		t->cut_parent();
+		if (m.t_first && !m.q->is_leaf())
+			m.q->insert_child(m.q->get_children().front(), p);
+		else
+			m.q->add_child(p);
+		if (m.n_first)
+			p->add_child(t);
+		else
+			p->insert_child(n, t);
+
+		moves.push_back(m);
+		return true;
+	}
+
+	// revert the most recent move
+	void revert() {
+		if (moves.empty())
+			return;
+		SPRMove &m = moves.back();
+
+		// undo the regraft
+		m.p->cut_parent();
+		m.t->cut_parent();
+		if (m.t_first && !m.q->is_leaf())
+			m.q->insert_child(m.q->get_children().front(), m.t);
+		else
+			m.q->add_child(m.t);
+
+		// undo the prune
+		m.s->cut_parent();
+		if (m.p_first && !m.g->is_leaf())
+			m.g->insert_child(m.g->get_children().front(), m.p);
+		else
+			m.g->add_child(m.p);
+		if (m.n_first)
+			m.p->add_child(m.s);
+		else
+			m.p->insert_child(m.n, m.s);
+
+		moves.pop_back();
+	}
+
+	// revert moves until only the first num_moves remain
+	void revert_to(int num_moves) {
+		while (moves.size() > num_moves)
+			revert();
+	}
+};
+
+#endif
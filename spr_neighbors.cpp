@@ -19,6 +19,8 @@
 #include "LCA.h"
 #include "spr_neighbors.h"
 #include "nni_neighbors.h"
+#include "shape_neighbors.h"
+#include "unrooted_neighbors.h"
 
 using namespace std;
 
@@ -28,13 +30,63 @@ int DIAMETER = 1;
 bool SIZE_ONLY = false;
 bool NNI_ONLY = false;
 bool IGNORE_ORIGINAL = false;
+bool SHAPE_ONLY = false;
+bool UNROOTED = false;
+bool TBR = false;
+bool DFS = false;
+string EQUIVALENCE_FILE = "";
 
 // USAGE
 string USAGE =
-"spr_neighbors, version 0.0.1\n";
+"spr_neighbors, version 0.0.1\n"
+"\n"
+"-k x               Find the neighborhood of diameter x (default 1)\n"
+"--nni              Use NNI moves instead of SPR moves\n"
+"--unrooted         Treat the tree as unrooted and use unrooted moves\n"
+"--tbr              Use unrooted TBR moves (implies --unrooted)\n"
+"--dfs              Search depth-first on a single tree, storing only\n"
+"                   the trees found rather than whole levels\n"
+"--size_only        Output only the number of trees\n"
+"--ignore_original  Do not include the input tree\n"
+"--shape            Treat leaves as unlabeled and output one tree per\n"
+"                   shape, prefixed by the number of labeled trees\n"
+"                   with that shape\n"
+"--equivalence f    As --shape, but only leaves listed on the same line\n"
+"                   of f are equivalent\n"
+"--help             Print this message\n";
 
 // FUNCTIONS
 
+void dfs_neighborhood(SPRJournal &journal, int depth,
+		map<string, short> &best_depth);
+
+/* find the trees within DIAMETER - depth moves of the journal's current
+	 tree. A tree is expanded again if it is reached at a smaller depth
+	 than before, so best_depth ends up holding the distance of each tree
+*/
+void dfs_neighborhood(SPRJournal &journal, int depth,
+		map<string, short> &best_depth) {
+	if (depth >= DIAMETER)
+		return;
+	Node *root = journal.root();
+	vector<pair<Node *, Node *> > moves = vector<pair<Node *, Node *> >();
+	if (NNI_ONLY)
+		get_nni_moves(root, root, moves);
+	else
+		get_spr_moves(root, root, moves);
+	for(int i = 0; i < moves.size(); i++) {
+		if (!journal.apply(moves[i].first, moves[i].second))
+			continue;
+		string name = normalized_str(journal.root());
+		map<string, short>::iterator x = best_depth.find(name);
+		if (x == best_depth.end() || x->second > depth + 1) {
+			best_depth[name] = depth + 1;
+			dfs_neighborhood(journal, depth + 1, best_depth);
+		}
+		journal.revert();
+	}
+}
+
 // MAIN
 
 int main(int argc, char *argv[]) {
@@ -59,6 +111,28 @@ int main(int argc, char *argv[]) {
 		else if (strcmp(arg, "--nni") == 0) {
 			NNI_ONLY = true;
 		}
+		else if (strcmp(arg, "--dfs") == 0) {
+			DFS = true;
+		}
+		else if (strcmp(arg, "--unrooted") == 0) {
+			UNROOTED = true;
+		}
+		else if (strcmp(arg, "--tbr") == 0) {
+			TBR = true;
+			UNROOTED = true;
+		}
+		else if (strcmp(arg, "--shape") == 0) {
+			SHAPE_ONLY = true;
+		}
+		else if (strcmp(arg, "--equivalence") == 0) {
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-') {
+					EQUIVALENCE_FILE = string(arg2);
+					SHAPE_ONLY = true;
+				}
+			}
+		}
 		else if (strcmp(arg, "--help") == 0) {
 			cout << USAGE;
 			return 0;
@@ -109,22 +183,74 @@ int main(int argc, char *argv[]) {
 		break;
 	}
 
+	if (DFS && (UNROOTED || SHAPE_ONLY)) {
+		cerr << "--dfs requires rooted trees without --shape" << endl;
+		return 1;
+	}
+	if (UNROOTED && SHAPE_ONLY) {
+		cerr << "--shape and --equivalence require rooted trees" << endl;
+		return 1;
+	}
+
+	// unrooted trees are represented by their canonical rooting
+	if (UNROOTED) {
+		string T_unrooted = unrooted_str(T);
+		T->delete_tree();
+		T = build_tree(T_unrooted);
+		T->preorder_number();
+	}
+
+	// leaf equivalence classes for shape-reduced neighborhoods
+	map<int, int> leaf_class = map<int, int>();
+	map<string, string> multiplicity = map<string, string>();
+	if (SHAPE_ONLY) {
+		if (EQUIVALENCE_FILE != "") {
+			ifstream equivalence_in(EQUIVALENCE_FILE.c_str());
+			if (!equivalence_in.is_open()) {
+				cerr << "could not open " << EQUIVALENCE_FILE << endl;
+				return 1;
+			}
+			read_leaf_equivalence(equivalence_in, &label_map, &leaf_class);
+		}
+		else {
+			all_leaves_equivalent(T, &leaf_class);
+		}
+	}
+
 	// TODO: vector of neighbourhood distances?
-	// known trees
+	// known trees (shape keys when SHAPE_ONLY)
 	set<string> known_trees = set<string>();
 
 	// new trees this round
 	list<Node *> new_trees = list<Node *>();
 	list<Node *> next_trees = list<Node *>();
 
-
 	// first tree
-	known_trees.insert(T->str_subtree());
 	string T_str = T->str_subtree();
+	if (SHAPE_ONLY) {
+		vector<int> symmetries = vector<int>();
+		T_str = shape_key(T, &leaf_class, &symmetries);
+		multiplicity[T_str] = labeled_count(T, &leaf_class, symmetries);
+	}
+	known_trees.insert(T_str);
 	new_trees.push_back(T);
 
+	if (DFS) {
+		map<string, short> best_depth = map<string, short>();
+		best_depth.insert(make_pair(T_str, 0));
+		{
+			SPRJournal journal = SPRJournal(T);
+			dfs_neighborhood(journal, 0, best_depth);
+		}
+		map<string, short>::iterator x;
+		for(x = best_depth.begin(); x != best_depth.end(); x++)
+			known_trees.insert(x->first);
+		new_trees.clear();
+		T->delete_tree();
+	}
+
 	// generate a given neighborhood size (command line arg or distance-1)
-	for (int i = 1; i <= DIAMETER; i++) {
+	for (int i = 1; i <= DIAMETER && !DFS; i++) {
 		list<Node *> found_trees = list<Node *>();
 		while(!new_trees.empty()) {
 			Node *tree = new_trees.front();
@@ -132,7 +258,25 @@ int main(int argc, char *argv[]) {
 
 //			cout << "current_tree: " << tree->str_subtree() << endl;
 			list<Node *> neighbors;
-			if (NNI_ONLY) {
+			if (SHAPE_ONLY) {
+				// all labeled neighbors of this tree, one per new shape
+				if (NNI_ONLY)
+					neighbors = get_nni_neighbors(tree);
+				else
+					neighbors = get_neighbors(tree);
+				neighbors = reduce_by_shape(neighbors, &leaf_class,
+						multiplicity, known_trees);
+			}
+			else if (TBR) {
+				neighbors = get_tbr_neighbors(tree, known_trees);
+			}
+			else if (UNROOTED && NNI_ONLY) {
+				neighbors = get_unrooted_nni_neighbors(tree, known_trees);
+			}
+			else if (UNROOTED) {
+				neighbors = get_unrooted_spr_neighbors(tree, known_trees);
+			}
+			else if (NNI_ONLY) {
 				neighbors = get_nni_neighbors(tree, known_trees);
 			}
 			else {
@@ -142,8 +286,10 @@ int main(int argc, char *argv[]) {
 			//cout << "n_size: " << neighbors.size() << endl;
 			for(t = neighbors.begin(); t != neighbors.end(); t++) {
 				// add to known trees and next_trees
-				string name = (*t)->str_subtree();
-				known_trees.insert(name);
+				if (!SHAPE_ONLY) {
+					string name = (*t)->str_subtree();
+					known_trees.insert(name);
+				}
 				next_trees.push_back(*t);
 			}
 			// cleanup
@@ -175,6 +321,8 @@ int main(int argc, char *argv[]) {
 			// hacky - do this better if necessary
 			Node *T = build_tree(*t);
 			T->numbers_to_labels(&reverse_label_map);
+			if (SHAPE_ONLY)
+				cout << multiplicity[*t] << "\t";
 			cout << T->str_subtree() << ";" << endl;
 			T->delete_tree();
 		}
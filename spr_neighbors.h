@@ -20,6 +20,7 @@
 
 #include "Forest.h"
 #include "LCA.h"
+#include "spr_journal.h"
 
 using namespace std;
 
@@ -27,95 +28,192 @@ using namespace std;
 
 list<Node *> get_neighbors(Node *tree);
 list<Node *> get_neighbors(Node *tree, set<string> &known_trees);
-void get_neighbors(Node *n, Node *root, list<Node *> &neighbors, set<string> &known_trees);
-void get_neighbors(Node *n, Node *new_sibling, Node *root, list<Node *> &neighbors, set<string> &known_trees);
-void add_neighbor(Node *n, Node *new_sibling, Node *root, list<Node *> &neighbors, set<string> &known_trees);
-
+void get_neighbors(Node *n, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees);
+void get_neighbors(Node *n, Node *new_sibling, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees);
+void add_neighbor(Node *n, Node *new_sibling, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees);
+bool is_unique_move(Node *n, Node *new_sibling);
+void get_spr_moves(Node *n, Node *root, vector<pair<Node *, Node *> > &moves);
+void get_spr_moves(Node *n, Node *new_sibling, Node *root, vector<pair<Node *, Node *> > &moves);
+void get_nni_moves(Node *n, Node *root, vector<pair<Node *, Node *> > &moves);
+string normalized_str(Node *n);
+int normalized_str_hlpr(Node *n, string *s);
+
+/* get a list of a trees neighbors without a visited set
+	 rules 1-5 in add_neighbor leave exactly one move for each neighbor:
+	 two distinct SPR moves only give the same tree when it is an NNI
+	 neighbor, and each rooted NNI neighbor can be reached by moving a
+	 subtree to its aunt, to its niece or up to its grandparent edge. We
+	 keep only the last of these
+*/
 list<Node *> get_neighbors(Node *tree) {
-	set<string> known_trees = set<string>();
-	return get_neighbors(tree, known_trees);
+	list<Node *> neighbors = list<Node *>();
+	SPRJournal journal = SPRJournal(tree);
+	get_neighbors(tree, journal, neighbors, NULL);
+	return neighbors;
 }
 
-// get a list of a trees neighbors
+// get a list of a trees neighbors that are not in known_trees
 list<Node *> get_neighbors(Node *tree, set<string> &known_trees) {
 	list<Node *> neighbors = list<Node *>();
-	get_neighbors(tree, tree, neighbors, known_trees);
+	SPRJournal journal = SPRJournal(tree);
+	get_neighbors(tree, journal, neighbors, &known_trees);
 	return neighbors;
 }
 
 // consider choices of subtree source
-void get_neighbors(Node *n, Node *root, list<Node *> &neighbors, set<string> &known_trees) {
+void get_neighbors(Node *n, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees) {
 
 	// recurse
 	if (n->lchild() != NULL) {
-		get_neighbors(n->lchild(), root, neighbors, known_trees);
+		get_neighbors(n->lchild(), journal, neighbors, known_trees);
 	}
 	if (n->rchild() != NULL) {
-		get_neighbors(n->rchild(), root, neighbors, known_trees);
+		get_neighbors(n->rchild(), journal, neighbors, known_trees);
 	}
 
-	get_neighbors(n, root, root, neighbors, known_trees);
+	get_neighbors(n, journal.root(), journal, neighbors, known_trees);
 }
 
 // consider choices of subtree target
-void get_neighbors(Node *n, Node *new_sibling, Node *root, list<Node *> &neighbors, set<string> &known_trees) {
+void get_neighbors(Node *n, Node *new_sibling, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees) {
 	if (n == new_sibling) {
 		return;
 	}
 	// recurse
 	if (new_sibling->lchild() != NULL) {
-		get_neighbors(n, new_sibling->lchild(), root, neighbors, known_trees);
+		get_neighbors(n, new_sibling->lchild(), journal, neighbors, known_trees);
 	}
 	if (new_sibling->rchild() != NULL) {
-		get_neighbors(n, new_sibling->rchild(), root, neighbors, known_trees);
+		get_neighbors(n, new_sibling->rchild(), journal, neighbors, known_trees);
 	}
 
-	add_neighbor(n, new_sibling, root, neighbors, known_trees);
+	add_neighbor(n, new_sibling, journal, neighbors, known_trees);
 
 }
 
-void add_neighbor(Node *n, Node *new_sibling, Node *root, list<Node *> &neighbors, set<string> &known_trees) {
+// false if moving n to new_sibling is a duplicate or does nothing
+bool is_unique_move(Node *n, Node *new_sibling) {
 
 	// check for obvious duplicates
 	if (n->parent() != NULL &&
 			(new_sibling == n->parent())) {
 	// cout << "rule 1" << endl;
-		return;
+		return false;
 	}
 	if (n->parent() != NULL &&
 			new_sibling->parent() != NULL &&
 			n->parent()->parent() == new_sibling->parent()) {
 //		cout << "rule 2" << endl;
-		return;
+		return false;
 	}
 	if (new_sibling == n->get_sibling()) {
 //		cout << "rule 3" << endl;
-		return;
+		return false;
 	}
 //		cout << "foo3" << endl;
 //	cout << "foo4" << endl;
 	if (new_sibling == n) {
 //		cout << "rule 4" << endl;
+		return false;
+	}
+	// moving to a niece is the same as moving the niece's sibling up
+	if (new_sibling->parent() != NULL &&
+			new_sibling->parent() == n->get_sibling()) {
+//		cout << "rule 5" << endl;
+		return false;
+	}
+	return true;
+}
+
+// collect the unique SPR moves of the tree as (subtree, new sibling) pairs
+void get_spr_moves(Node *n, Node *root, vector<pair<Node *, Node *> > &moves) {
+	if (n->lchild() != NULL)
+		get_spr_moves(n->lchild(), root, moves);
+	if (n->rchild() != NULL)
+		get_spr_moves(n->rchild(), root, moves);
+	get_spr_moves(n, root, root, moves);
+}
+
+void get_spr_moves(Node *n, Node *new_sibling, Node *root, vector<pair<Node *, Node *> > &moves) {
+	if (n == new_sibling)
+		return;
+	if (new_sibling->lchild() != NULL)
+		get_spr_moves(n, new_sibling->lchild(), root, moves);
+	if (new_sibling->rchild() != NULL)
+		get_spr_moves(n, new_sibling->rchild(), root, moves);
+	if (is_unique_move(n, new_sibling))
+		moves.push_back(make_pair(n, new_sibling));
+}
+
+// NNI moves as in get_nni_neighbors: each subtree to its grandparent edge
+void get_nni_moves(Node *n, Node *root, vector<pair<Node *, Node *> > &moves) {
+	if (n->lchild() != NULL)
+		get_nni_moves(n->lchild(), root, moves);
+	if (n->rchild() != NULL)
+		get_nni_moves(n->rchild(), root, moves);
+	if (n != root && n->parent() != root)
+		moves.push_back(make_pair(n, n->parent()->parent()));
+}
+
+/* the string of the tree after normalize_order, without modifying or
+	 copying the tree
+*/
+string normalized_str(Node *n) {
+	string s = "";
+	normalized_str_hlpr(n, &s);
+	return s;
+}
+
+int normalized_str_hlpr(Node *n, string *s) {
+	*s += n->get_name();
+	if (n->is_leaf())
+		return n->get_name_num();
+	map<int, string> ordered_children = map<int, string>();
+	list<Node *>::iterator c;
+	for(c = n->get_children().begin(); c != n->get_children().end(); c++) {
+		string child = "";
+		int min_descendant = normalized_str_hlpr(*c, &child);
+		ordered_children.insert(make_pair(min_descendant, child));
+	}
+	*s += "(";
+	map<int, string>::iterator oc;
+	for(oc = ordered_children.begin(); oc != ordered_children.end(); oc++) {
+		if (oc != ordered_children.begin())
+			*s += ",";
+		*s += oc->second;
+	}
+	*s += ")";
+	return ordered_children.begin()->first;
+}
+
+void add_neighbor(Node *n, Node *new_sibling, SPRJournal &journal, list<Node *> &neighbors, set<string> *known_trees) {
+
+	if (!is_unique_move(n, new_sibling))
+		return;
+//	cout << "original: " << journal.root()->str_subtree() << endl;
+	if (!journal.apply(n, new_sibling))
+		return;
+
+	if (known_trees == NULL) {
+		// the move is known to be unique
+		Node *new_tree = new Node(*journal.root());
+		new_tree->normalize_order();
+		neighbors.push_back(new_tree);
+		journal.revert();
 		return;
 	}
-	Node *old_sibling = n->get_sibling();
-	//if (new_sibling != old_sibling)
-	//
-	int which_sibling = 0;
-//	cout << "original: " << root->str_subtree() << endl;
-	Node *undo = n->spr(new_sibling, which_sibling);
-
-	string name = root->str_subtree();
+
+	string name = journal.root()->str_subtree();
 	// quick check for obvious duplicate
-	set<string>::iterator x = known_trees.find(name);
-	if (x == known_trees.end()) {
+	set<string>::iterator x = known_trees->find(name);
+	if (x == known_trees->end()) {
 		Node *new_tree = build_tree(name);
 		// normalize and check again
 		new_tree->normalize_order();
 		name = new_tree->str_subtree();
-		x = known_trees.find(name);
-		if (x == known_trees.end()) {
-			known_trees.insert(name);
+		x = known_trees->find(name);
+		if (x == known_trees->end()) {
+			known_trees->insert(name);
 			neighbors.push_back(new_tree);
 		}
 		else {
@@ -126,8 +224,8 @@ void add_neighbor(Node *n, Node *new_sibling, Node *root, list<Node *> &neighbor
 
 
 
-	n->spr(undo, which_sibling);
-//	cout << "reverted: " << root->str_subtree() << endl;
+	journal.revert();
+//	cout << "reverted: " << journal.root()->str_subtree() << endl;
 //	cout << endl;
 }
 
@@ -136,6 +136,11 @@ SEARCH STRATEGY OPTIONS
 
 -rf_ties              Break SPR distance ties with the RF distance
 
+-parallel_moves       Evaluate the rearrangements of the global search in
+                      parallel, each thread with its own copy of the
+                      supertree. Ties are broken by the search order
+                      rather than at random
+
 *******************************************************************************
 LGT ANALYSIS
 *******************************************************************************
@@ -167,6 +172,9 @@ OTHER OPTIONS
 
 -multi_trees           Output the set of multifurcating or invalid trees
 
+-solver_stats f        Write solver statistics as JSON to the file f, or to
+                       stderr if no file is given
+
 *******************************************************************************/
 
 #include <cstdio>
@@ -220,6 +228,8 @@ bool RANDOM_ROOTING = false;
 bool RANDOM_INSERT_ORDER = false;
 bool APPROX = false;
 bool TIMING = false;
+bool STATS = false;
+string STATS_FILE = "";
 int NUM_ITERATIONS = 25;
 bool SMALL_TREES = false;
 bool CONVERT_LIST = false;
@@ -240,6 +250,9 @@ bool TABOO_SEARCH = false;
 bool ONE_TREE_AT_A_TIME = false;
 bool NODE_GLOM_CONSTRUCTION = false;
 bool USE_PRECOMPUTED_DISTANCES = false;
+bool PARALLEL_MOVES = false;
+// the best distance found by any thread of the parallel move search
+int SHARED_MIN_DISTANCE = INT_MAX;
 
 /*variables Joel added*/
 int R_DISTANCE;
@@ -390,6 +403,11 @@ string USAGE =
 "\n"
 "-rf_ties              Break SPR distance ties with the RF distance\n"
 "\n"
+"-parallel_moves       Evaluate the rearrangements of the global search in\n"
+"                      parallel, each thread with its own copy of the\n"
+"                      supertree. Ties are broken by the search order\n"
+"                      rather than at random\n"
+"\n"
 "*******************************************************************************\n"
 "LGT ANALYSIS\n"
 "*******************************************************************************\n"
@@ -419,7 +437,10 @@ string USAGE =
 "-valid_trees_rooted    Output the set of trees that appear valid after applying\n"
 "                       any rooting options.\n"
 "\n"
-"-multi_trees           Output the set of multifurcating or invalid trees\n";
+"-multi_trees           Output the set of multifurcating or invalid trees\n"
+"\n"
+"-solver_stats f        Write solver statistics as JSON to the file f, or to\n"
+"                       stderr if no file is given\n";
 
 Node *find_best_sibling(Node *super_tree, vector<Node *> &gene_trees,
 		int label);
@@ -435,14 +456,37 @@ void find_best_siblings_helper(Node *n, Node *new_leaf, Node *super_tree,
 void test_sibling_helper(Node *n, Node *new_leaf, Node *super_tree,
 		vector<Node *> &gene_trees, int &min_distance, int &min_tie_distance,
 		int &num_ties, Node **best_sibling);
+/* the distances from the supertree to a set of gene trees at the start
+	 of a round of moves, with the sorted preorder numbers of each gene
+	 tree's taxa in the supertree, so that a move which does not change
+	 the supertree restricted to a gene tree can reuse its distance
+*/
+struct GeneTreeScores {
+	vector<int> scores;
+	vector<const vector<int> *> positions;
+};
+void restricted_positions(Node *super_tree, vector<Node *> &gene_trees,
+		vector<vector<int> > *positions);
+int last_preorder_number(Node *n);
+int restricted_count(Node *n, Node *v, const vector<int> &positions,
+		int subtree_count);
+Node *restricted_attachment(Node *n, Node *v, const vector<int> &positions,
+		int subtree_count);
+bool spr_preserves_restriction(Node *n, Node *new_sibling,
+		const vector<int> &positions);
 void find_best_spr(Node *super_tree, vector<Node *> &gene_trees,
 		Node *&best_spr_move, Node *&best_sibling);
+void find_best_spr(Node *super_tree, vector<Node *> &gene_trees,
+		Node *&best_spr_move, Node *&best_sibling,
+		vector<int> *original_scores);
 void find_best_spr_helper(Node *n, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
-		Node *&best_sibling, int &min_distance, int &num_ties);
+		Node *&best_sibling, int &min_distance, int &num_ties,
+		GeneTreeScores *cached_scores);
 void find_best_spr_helper(Node *n, Node *new_sibling, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
-		Node *&best_sibling, int &min_distance, int &num_ties);
+		Node *&best_sibling, int &min_distance, int &num_ties,
+		GeneTreeScores *cached_scores);
 void get_support(Node *super_tree, vector<Node *> *gene_trees);
 void get_support(Node *n, Node *super_tree, vector<Node *> *gene_trees);
 void get_transfer_support(Node *super_tree, vector<Node *> *gene_trees);
@@ -452,6 +496,15 @@ void get_bipartition_support(Node *super_tree, vector<Node *> *gene_trees,
 bool supported_spr(Node *source, Node *target);
 bool pair_comparator (pair<int, int> a, pair<int, int> b);
 
+void find_best_spr_r_source(Node *n, Node *super_tree,
+		vector<Node *> &gene_trees, Node *&best_spr_move,
+		Node *&best_sibling, int &min_distance, int &min_tie_distance,
+		int &num_ties, int r, vector<int> *original_scores,
+		vector<vector<int> > *positions);
+void find_best_spr_r_parallel(Node *super_tree, vector<Node *> &gene_trees,
+		Node *&best_spr_move, Node *&best_sibling, int r,
+		vector<int> *original_scores);
+
 /*Prototypes of Joel's functions*/
 void find_best_spr_r(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling, int r);
 void find_best_spr_r(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling, int r, vector<int> *original_scores);
@@ -462,14 +515,15 @@ void find_best_spr_r_helper(Node *n, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
 		Node *&best_sibling, int &min_distance, int &min_tie_distance,
 		int &num_ties, int r,
-		vector<int> *original_scores);
+		vector<int> *original_scores, vector<vector<int> > *positions);
 void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
 		Node *&best_sibling, int &min_distance, int &num_ties, int r, int origin);
 void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
 		Node *&best_sibling, int &min_distance, int &min_tie_distance,
-		int &num_ties, int r, int origin, int offset);
+		int &num_ties, int r, int origin, int offset,
+		GeneTreeScores *cached_scores);
 void find_best_spr(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling, vector <pair <int, pair<int, int> > > &stats);
 void find_best_spr_helper(Node *n, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
@@ -535,7 +589,7 @@ int main(int argc, char *argv[]) {
 			DEFAULT_ALGORITHM=false;
 		}
 		else if (strcmp(arg, "-bb") == 0) {
-			BB = true;
+			rspr_context()->BB = true;
 			DEFAULT_ALGORITHM=false;
 		}
 		else if (strcmp(arg, "-approx") == 0) {
@@ -544,7 +598,7 @@ int main(int argc, char *argv[]) {
 		else if (strcmp(arg, "-q") == 0)
 			QUIET = true;
 		else if (strcmp(arg, "-cc") == 0)
-			APPROX_CHECK_COMPONENT = true;
+			rspr_context()->APPROX_CHECK_COMPONENT = true;
 		else if (strcmp(arg, "-unrooted") == 0)
 			UNROOTED = true;
 		else if (strcmp(arg, "-simple_unrooted") == 0) {
@@ -604,33 +658,33 @@ int main(int argc, char *argv[]) {
 		}
 		else if (strcmp(arg, "-unrooted_min_approx") == 0) {
 			UNROOTED = true;
-			UNROOTED_MIN_APPROX = true;
+			rspr_context()->UNROOTED_MIN_APPROX = true;
 		}
 		else if (strcmp(arg, "-noopt") == 0) {
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_one_b") == 0 ||
 				strcmp(arg, "-cob") == 0) {
-			CUT_ONE_B = true;
+			rspr_context()->CUT_ONE_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-reverse_cut_one_b") == 0 ||
 				strcmp(arg, "-rcob") == 0) {
-			REVERSE_CUT_ONE_B = true;
+			rspr_context()->REVERSE_CUT_ONE_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_all_b") == 0 ||
 				strcmp(arg, "-cab") == 0) {
-			CUT_ALL_B = true;
+			rspr_context()->CUT_ALL_B = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_ac_separate_components") == 0 ||
 				strcmp(arg, "-sc") == 0) {
-			CUT_AC_SEPARATE_COMPONENTS = true;
+			rspr_context()->CUT_AC_SEPARATE_COMPONENTS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-cut_one_ab") == 0) {
-			CUT_ONE_AB = true;
+			rspr_context()->CUT_ONE_AB = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-h") == 0) {
@@ -649,7 +703,7 @@ int main(int argc, char *argv[]) {
 		}
 */
 		else if (strcmp(arg, "-prefer_rho") == 0) {
-			PREFER_RHO = true;
+			rspr_context()->PREFER_RHO = true;
 		}
 /*
 		else if (strcmp(arg, "-memoize") == 0) {
@@ -757,16 +811,16 @@ int main(int argc, char *argv[]) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-')
-					MAX_SPR = atoi(arg2);
-				cout << "MAX_SPR=" << MAX_SPR << endl;
+					rspr_context()->MAX_SPR = atoi(arg2);
+				cout << "MAX_SPR=" << rspr_context()->MAX_SPR << endl;
 			}
 		}
 		else if (strcmp(arg, "-cluster_max") == 0) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-') {
-					CLUSTER_MAX_SPR = atoi(arg2);
-				cout << "CLUSTER_MAX_SPR=" << CLUSTER_MAX_SPR << endl;
+					rspr_context()->CLUSTER_MAX_SPR = atoi(arg2);
+				cout << "CLUSTER_MAX_SPR=" << rspr_context()->CLUSTER_MAX_SPR << endl;
 				}
 			}
 		}
@@ -782,7 +836,7 @@ int main(int argc, char *argv[]) {
 			TIMING= true;
 		}
 		else if (strcmp(arg, "-clamp") == 0) {
-			CLAMP= true;
+			rspr_context()->CLAMP= true;
 		}
 		else if (strcmp(arg, "-small_trees") == 0) {
 			SMALL_TREES=true;
@@ -822,35 +876,35 @@ int main(int argc, char *argv[]) {
 			IGNORE_MULTI = false;
 		}
 		else if (strcmp(arg, "-protect_edges") == 0) {
-			EDGE_PROTECTION = true;
+			rspr_context()->EDGE_PROTECTION = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-allow_abort") == 0) {
-			ABORT_AT_FIRST_SOLUTION = true;
+			rspr_context()->ABORT_AT_FIRST_SOLUTION = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-preorder_sib_pairs") == 0) {
-			PREORDER_SIBLING_PAIRS = true;
-			NEAR_PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-near_preorder_sib_pairs") == 0) {
-			NEAR_PREORDER_SIBLING_PAIRS = true;
+			rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
 			DEFAULT_OPTIMIZATIONS=false;
 		}
 		else if (strcmp(arg, "-leaf_reduction") == 0) {
-			LEAF_REDUCTION = true;
+			rspr_context()->LEAF_REDUCTION = true;
 		}
 		else if (strcmp(arg, "-leaf_reduction2") == 0) {
-			LEAF_REDUCTION2 = true;
+			rspr_context()->LEAF_REDUCTION2 = true;
 		}
 		else if (strcmp(arg, "-split_approx") == 0) {
-			SPLIT_APPROX = true;
+			rspr_context()->SPLIT_APPROX = true;
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-')
-					SPLIT_APPROX_THRESHOLD = atoi(arg2);
-				cout << "SPLIT_APPROX_THRESHOLD=" << SPLIT_APPROX_THRESHOLD
+					rspr_context()->SPLIT_APPROX_THRESHOLD = atoi(arg2);
+				cout << "SPLIT_APPROX_THRESHOLD=" << rspr_context()->SPLIT_APPROX_THRESHOLD
 						<< endl;
 			}
 		}
@@ -872,6 +926,18 @@ int main(int argc, char *argv[]) {
 						<< endl;
 			}
 		}
+		else if (strcmp(arg, "-parallel_moves") == 0) {
+			PARALLEL_MOVES = true;
+		}
+		else if (strcmp(arg, "-solver_stats") == 0) {
+			STATS = true;
+			rspr_context()->COLLECT_STATS = true;
+			if (max_args > argc) {
+				char *arg2 = argv[argc+1];
+				if (arg2[0] != '-')
+					STATS_FILE = arg2;
+			}
+		}
 		else if (strcmp(arg, "-include_only") == 0) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
@@ -921,10 +987,10 @@ int main(int argc, char *argv[]) {
 			}
 		}
 		else if (strcmp(arg, "-count_losses") == 0) {
-			COUNT_LOSSES = true;
+			rspr_context()->COUNT_LOSSES = true;
 		}
 		else if (strcmp(arg, "-cut_lost") == 0) {
-			CUT_LOST = true;
+			rspr_context()->CUT_LOST = true;
 		}
 		else if (strcmp(arg, "-find_support") == 0) {
 			FIND_SUPPORT = true;
@@ -970,8 +1036,8 @@ int main(int argc, char *argv[]) {
 			if (max_args > argc) {
 				char *arg2 = argv[argc+1];
 				if (arg2[0] != '-') {
-					CLUSTER_TUNE = atoi(arg2);
-					cout << "CLUSTER_TUNE=" << CLUSTER_TUNE << endl;
+					rspr_context()->CLUSTER_TUNE = atoi(arg2);
+					cout << "CLUSTER_TUNE=" << rspr_context()->CLUSTER_TUNE << endl;
 				}
 			}
 		}
@@ -982,38 +1048,38 @@ int main(int argc, char *argv[]) {
 			
 	}
 	if (DEFAULT_OPTIMIZATIONS) {
-		CUT_ALL_B=true;
-		CUT_ONE_B = true;
-		CUT_TWO_B = true;
+		rspr_context()->CUT_ALL_B=true;
+		rspr_context()->CUT_ONE_B = true;
+		rspr_context()->CUT_TWO_B = true;
 //		CUT_TWO_B_ROOT = true;
-		REVERSE_CUT_ONE_B = true;
-		REVERSE_CUT_ONE_B_3 = true;
-		CUT_AC_SEPARATE_COMPONENTS = true;
-		EDGE_PROTECTION = true;
-		EDGE_PROTECTION_TWO_B = true;
-		PREFER_NONBRANCHING = true;
+		rspr_context()->REVERSE_CUT_ONE_B = true;
+		rspr_context()->REVERSE_CUT_ONE_B_3 = true;
+		rspr_context()->CUT_AC_SEPARATE_COMPONENTS = true;
+		rspr_context()->EDGE_PROTECTION = true;
+		rspr_context()->EDGE_PROTECTION_TWO_B = true;
+		rspr_context()->PREFER_NONBRANCHING = true;
 
 //		CHECK_MERGE_DEPTH = true;
 //		ABORT_AT_FIRST_SOLUTION = true;
-		PREORDER_SIBLING_PAIRS = true;
-		NEAR_PREORDER_SIBLING_PAIRS = true;
-		LEAF_REDUCTION = true;
-		LEAF_REDUCTION2 = true;
+		rspr_context()->PREORDER_SIBLING_PAIRS = true;
+		rspr_context()->NEAR_PREORDER_SIBLING_PAIRS = true;
+		rspr_context()->LEAF_REDUCTION = true;
+		rspr_context()->LEAF_REDUCTION2 = true;
 
-		APPROX_CUT_ONE_B = true;
-		APPROX_CUT_TWO_B = true;
+		rspr_context()->APPROX_CUT_ONE_B = true;
+		rspr_context()->APPROX_CUT_TWO_B = true;
 //		APPROX_CUT_TWO_B_ROOT = true;
-		APPROX_REVERSE_CUT_ONE_B = true;
+		rspr_context()->APPROX_REVERSE_CUT_ONE_B = true;
 /* BUGGY: we aren't guaranteed that the protected edges mean
 	 anything because we may cut off the only things that can merge with
 	 them. It might make sense to cut a protected edge because it should
 	 have already merged by then.
 */
 //		APPROX_EDGE_PROTECTION = true;
-		DEEPEST_PROTECTED_ORDER = true;
-		DEEPEST_ORDER = true;
-		if (CLUSTER_TUNE == -1) {
-			CLUSTER_TUNE = 30;
+		rspr_context()->DEEPEST_PROTECTED_ORDER = true;
+		rspr_context()->DEEPEST_ORDER = true;
+		if (rspr_context()->CLUSTER_TUNE == -1) {
+			rspr_context()->CLUSTER_TUNE = 30;
 		}
 	}
 	if (DEFAULT_SEARCH_OPTIMIZATIONS) {
@@ -1025,10 +1091,10 @@ int main(int argc, char *argv[]) {
 			R_DISTANCE = INT_MAX - 1000;
 		}
 	}
-	PREORDER_SIBLING_PAIRS = true;
+	rspr_context()->PREORDER_SIBLING_PAIRS = true;
 	if (DEFAULT_ALGORITHM) {
-		BB=true;
-		PREFER_RHO = true;
+		rspr_context()->BB=true;
+		rspr_context()->PREFER_RHO = true;
 	}
 
 
@@ -1273,6 +1339,10 @@ int main(int argc, char *argv[]) {
 	if (TIMING)
 		time = clock()/(double)CLOCKS_PER_SEC;
 
+	// the leaves of each gene tree, to restrict the supertree to
+	GeneTreeIndex gene_tree_index = GeneTreeIndex(gene_trees);
+	rspr_context()->GENE_TREE_INDEX = &gene_tree_index;
+
 	if (NODE_GLOM_CONSTRUCTION) {
 
 		// copy the gene trees
@@ -1435,6 +1505,8 @@ TODO:
 			gene_trees[i]->delete_tree();
 		}
 		gene_trees = gene_trees_copy;
+		gene_tree_index.clear();
+		gene_tree_index.add(gene_trees);
 	}
 	else {
 
@@ -1702,8 +1774,10 @@ TODO:
 				// reroot the gene trees based on the balanced accuracy of splits
 				super_tree->preorder_number();
 				int end = current_gene_trees.size();
+				RsprContext *context = rspr_context();
 				#pragma omp parallel for
 				for(int i = 0; i < end; i++) {
+					RsprContextCopy thread_context(context);
 					current_gene_trees[i]->preorder_number();
 					Node *new_root;
 					if (EXACT_ROOTING)
@@ -1717,6 +1791,7 @@ TODO:
 						current_gene_trees[i]->set_depth(0);
 						current_gene_trees[i]->fix_depths();
 						current_gene_trees[i]->preorder_number();
+						gene_tree_index.update(current_gene_trees[i]);
 					}
 				}
 			}
@@ -1755,7 +1830,7 @@ TODO:
 
 	if (!LGT_ANALYSIS && !LGT_EVALUATION) {
 
-			if (UNROOTED_MIN_APPROX)
+			if (rspr_context()->UNROOTED_MIN_APPROX)
 				APPROX_ROOTING=true;
 			if (REROOT_INITIAL) {
 				cout << "rerooting super_tree" << endl;
@@ -1840,8 +1915,10 @@ TODO:
 		// reroot the gene trees based on the balanced accuracy of splits
 		super_tree->preorder_number();
 		int end = gene_trees.size();
+		RsprContext *context = rspr_context();
 		#pragma omp parallel for
 		for(int i = 0; i < end; i++) {
+			RsprContextCopy thread_context(context);
 			gene_trees[i]->preorder_number();
 			Node *new_root;
 			if (EXACT_ROOTING)
@@ -1856,6 +1933,7 @@ TODO:
 				gene_trees[i]->set_depth(0);
 				gene_trees[i]->fix_depths();
 				gene_trees[i]->preorder_number();
+				gene_tree_index.update(gene_trees[i]);
 			}
 		}
 	}
@@ -2135,6 +2213,8 @@ TODO:
 			}
 			super_tree->delete_tree();
 			best_supertree->delete_tree();
+			if (STATS)
+				print_rspr_stats(STATS_FILE);
 			return 0;
 		}
 
@@ -2250,8 +2330,10 @@ TODO:
 			// reroot the gene trees based on the balanced accuracy of splits
 			super_tree->preorder_number();
 			int end = gene_trees.size();
+			RsprContext *context = rspr_context();
 			#pragma omp parallel for
 			for(int i = 0; i < end; i++) {
+				RsprContextCopy thread_context(context);
 				gene_trees[i]->preorder_number();
 				Node *new_root;
 				if (EXACT_ROOTING)
@@ -2265,6 +2347,7 @@ TODO:
 					gene_trees[i]->set_depth(0);
 					gene_trees[i]->fix_depths();
 					gene_trees[i]->preorder_number();
+					gene_tree_index.update(gene_trees[i]);
 				}
 			}
 		}
@@ -2605,7 +2688,7 @@ TODO:
 			if (!APPROX) {
 				original_scores = new vector<int>(gene_trees.size(), 0);
 				int distance;
-				if (UNROOTED_MIN_APPROX) {
+				if (UNROOTED) {
 					distance = rSPR_total_distance_unrooted(super_tree, gene_trees, INT_MAX, original_scores);
 				}
 				else {
@@ -2623,7 +2706,7 @@ TODO:
 			NUM_SOURCE = super_tree->size();
 			C_SOURCE = 1;
 			find_best_spr_r(super_tree, gene_trees, best_subtree_root, best_sibling,r, original_scores);
-			if ((!UNROOTED || UNROOTED_MIN_APPROX) && !APPROX) {
+			if (!APPROX) {
 				delete original_scores;
 				cout << endl;
 			}
@@ -2634,7 +2717,7 @@ TODO:
 			int num_ties = 0;
 			for(vector<pair<Node *, int> >::const_iterator i = best_scores.begin(); i!= best_scores.end(); i++){
 				Node *source = i->first;
-				find_best_spr_helper(source, super_tree, gene_trees, best_subtree_root, best_sibling, min_distance, num_ties);
+				find_best_spr_helper(source, super_tree, gene_trees, best_subtree_root, best_sibling, min_distance, num_ties, NULL);
 			}
 
 		}
@@ -2759,7 +2842,19 @@ TODO:
 		}
 /*Default strategy*/	
 		else {
-			find_best_spr(super_tree, gene_trees, best_subtree_root, best_sibling);
+			// the distance to each gene tree, for moves that do not change it
+			vector<int> *original_scores = NULL;
+			if (!APPROX) {
+				original_scores = new vector<int>(gene_trees.size(), 0);
+				if (UNROOTED)
+					rSPR_total_distance_unrooted(super_tree, gene_trees, INT_MAX,
+							original_scores);
+				else
+					rSPR_total_distance(super_tree, gene_trees, original_scores);
+			}
+			find_best_spr(super_tree, gene_trees, best_subtree_root, best_sibling,
+					original_scores);
+			delete original_scores;
 		}
 		if(!GREEDY && !GREEDY_REFINED) {
 			if (!ONE_TREE_AT_A_TIME){
@@ -2861,6 +2956,8 @@ TODO:
 	}
 	super_tree->delete_tree();
 
+	if (STATS)
+		print_rspr_stats(STATS_FILE);
 	return 0;
 
 }
@@ -3109,33 +3206,59 @@ void find_best_siblings_helper(Node *n, Node *new_leaf, Node *super_tree,
 
 
 void find_best_spr(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling) {
+	find_best_spr(super_tree, gene_trees, best_spr_move, best_sibling, NULL);
+}
+
+/* original_scores, if not NULL, are the distances from super_tree to
+	 each gene tree, which moves that do not change them reuse
+*/
+void find_best_spr(Node *super_tree, vector<Node *> &gene_trees,
+		Node *&best_spr_move, Node *&best_sibling,
+		vector<int> *original_scores) {
 	int min_distance = INT_MAX;
 	int num_ties = 0;
+	vector<vector<int> > positions = vector<vector<int> >();
+	GeneTreeScores cached_scores = GeneTreeScores();
+	GeneTreeScores *cached_scores_p = NULL;
+	if (original_scores != NULL) {
+		super_tree->preorder_number();
+		restricted_positions(super_tree, gene_trees, &positions);
+		cached_scores.scores = *original_scores;
+		for(int i = 0; i < positions.size(); i++)
+			cached_scores.positions.push_back(&positions[i]);
+		cached_scores_p = &cached_scores;
+	}
 	find_best_spr_helper(super_tree, super_tree, gene_trees,
-			best_spr_move, best_sibling, min_distance, num_ties);
+			best_spr_move, best_sibling, min_distance, num_ties,
+			cached_scores_p);
 }
 
 void find_best_spr_helper(Node *n, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
-		Node *&best_sibling, int &min_distance, int &num_ties) {
+		Node *&best_sibling, int &min_distance, int &num_ties,
+		GeneTreeScores *cached_scores) {
 
 	if (n->lchild() != NULL) {
 		find_best_spr_helper(n->lchild(), super_tree,
-				gene_trees, best_spr_move, best_sibling, min_distance, num_ties);
+				gene_trees, best_spr_move, best_sibling, min_distance, num_ties,
+				cached_scores);
 	}
 	if (n->rchild() != NULL) {
 		find_best_spr_helper(n->rchild(), super_tree,
-				gene_trees, best_spr_move, best_sibling, min_distance, num_ties);
+				gene_trees, best_spr_move, best_sibling, min_distance, num_ties,
+				cached_scores);
 	}
 
 		find_best_spr_helper(n, super_tree, super_tree,
-				gene_trees, best_spr_move, best_sibling, min_distance, num_ties);
+				gene_trees, best_spr_move, best_sibling, min_distance, num_ties,
+				cached_scores);
 
 }
 
 void find_best_spr_helper(Node *n, Node *new_sibling, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
-		Node *&best_sibling, int &min_distance, int &num_ties) {
+		Node *&best_sibling, int &min_distance, int &num_ties,
+		GeneTreeScores *cached_scores) {
 	// do not consider invalid spr moves to n's subtree
 	if (new_sibling == n)
 		return;
@@ -3143,11 +3266,13 @@ void find_best_spr_helper(Node *n, Node *new_sibling, Node *super_tree,
 	// recurse
 	if (new_sibling->lchild() != NULL) {
 		find_best_spr_helper(n, new_sibling->lchild(), super_tree,
-				gene_trees, best_spr_move, best_sibling, min_distance, num_ties);
+				gene_trees, best_spr_move, best_sibling, min_distance, num_ties,
+				cached_scores);
 	}
 	if (new_sibling->rchild() != NULL) {
 		find_best_spr_helper(n, new_sibling->rchild(), super_tree,
-				gene_trees, best_spr_move, best_sibling, min_distance, num_ties);
+				gene_trees, best_spr_move, best_sibling, min_distance, num_ties,
+				cached_scores);
 	}
 //	cout << "n: " << n->str_subtree() << endl;
 //	cout << "s: " << new_sibling->str_subtree() << endl;
@@ -3187,6 +3312,21 @@ void find_best_spr_helper(Node *n, Node *new_sibling, Node *super_tree,
 		super_tree->labels_to_numbers(&label_map, &reverse_label_map);
 */
 	
+		// gene trees that the move does not change keep their distance
+		vector<Node *> changed_gene_trees;
+		vector<Node *> *scored_gene_trees = &gene_trees;
+		int unchanged_offset = 0;
+		if (cached_scores != NULL) {
+			changed_gene_trees = vector<Node *>();
+			for(int i = 0; i < gene_trees.size(); i++) {
+				if (spr_preserves_restriction(n, new_sibling,
+						*cached_scores->positions[i]))
+					unchanged_offset += cached_scores->scores[i];
+				else
+					changed_gene_trees.push_back(gene_trees[i]);
+			}
+			scored_gene_trees = &changed_gene_trees;
+		}
 
 		int which_sibling = 0;
 		Node *undo = n->spr(new_sibling, which_sibling);
@@ -3204,19 +3344,24 @@ void find_best_spr_helper(Node *n, Node *new_sibling, Node *super_tree,
 
 
 		int distance;
+		int threshold = min_distance;
+		if (threshold < INT_MAX)
+			threshold -= unchanged_offset;
 		if (APPROX) {
 			if (UNROOTED)
-				distance = rSPR_total_approx_distance_unrooted(super_tree, gene_trees);
+				distance = rSPR_total_approx_distance_unrooted(super_tree, *scored_gene_trees);
 			else
-				distance = rSPR_total_approx_distance(super_tree, gene_trees);
+				distance = rSPR_total_approx_distance(super_tree, *scored_gene_trees);
 		}
 		else {
 			if (UNROOTED)
-				distance = rSPR_total_distance_unrooted(super_tree, gene_trees,
-						min_distance);
+				distance = rSPR_total_distance_unrooted(super_tree,
+						*scored_gene_trees, threshold);
 			else
-				distance = rSPR_total_distance(super_tree, gene_trees, min_distance);
+				distance = rSPR_total_distance(super_tree, *scored_gene_trees,
+						threshold);
 		}
+		distance += unchanged_offset;
 //		cout << "\t" << distance << endl;
 
 		if (distance < min_distance) {
@@ -3290,8 +3435,10 @@ void get_transfer_support(Node *super_tree, vector<Node *> *gene_trees) {
 	vector<Node *> descendants = super_tree->find_descendants();
 	descendants.push_back(super_tree);
 	int end = descendants.size();
+	RsprContext *context = rspr_context();
 	#pragma omp parallel for
 	for(int i = 0; i < end; i++) {
+		RsprContextCopy thread_context(context);
 		get_transfer_support(descendants[i], super_tree, gene_trees);
 	}
 }
@@ -3346,7 +3493,7 @@ void find_best_distance(Node * n, Node * super_tree, vector<Node *> &gene_trees,
 		UndoMachine um = UndoMachine();
 		vector<Node *> components = vector<Node *>();
 		Node *n_parent = n->parent();
-		um.add_event(new CutParent(n));
+		um.add_event(CutParent(n));
 		n->cut_parent();
 		ContractEvent(&um, n_parent);
 		Node *post_contract = n_parent->contract();
@@ -3687,17 +3834,192 @@ bool sort_approx_moves(const pair<pair<Node*, Node*>, int> &a, const pair<pair<N
 /*end*/
 
 /*Joel: Limit SPR Radius*/
+/* the sorted preorder numbers of each gene tree's taxa in the supertree,
+	 which stay the same for every move of a round as each move is undone
+*/
+void restricted_positions(Node *super_tree, vector<Node *> &gene_trees,
+		vector<vector<int> > *positions) {
+	map<int, int> super_leaves = map<int, int>();
+	vector<Node *> all_leaves = super_tree->find_leaves();
+	for(int j = 0; j < all_leaves.size(); j++) {
+		super_leaves.insert(make_pair(atoi(all_leaves[j]->get_name().c_str()),
+				all_leaves[j]->get_preorder_number()));
+	}
+	positions->clear();
+	for(int i = 0; i < gene_trees.size(); i++) {
+		positions->push_back(vector<int>());
+		vector<Node *> gene_leaves = gene_trees[i]->find_leaves();
+		for(int j = 0; j < gene_leaves.size(); j++) {
+			map<int, int>::iterator l = super_leaves.find(
+					atoi(gene_leaves[j]->get_name().c_str()));
+			if (l != super_leaves.end())
+				positions->back().push_back(l->second);
+		}
+		sort(positions->back().begin(), positions->back().end());
+	}
+}
+
+// the largest preorder number in n's subtree
+int last_preorder_number(Node *n) {
+	while (!n->is_leaf())
+		n = n->get_children().back();
+	return n->get_preorder_number();
+}
+
+/* the number of the sorted preorder positions that fall in v's subtree,
+	 not counting the subtree_count positions in n's subtree
+*/
+int restricted_count(Node *n, Node *v, const vector<int> &positions,
+		int subtree_count) {
+	int start = v->get_preorder_number();
+	int end = last_preorder_number(v);
+	int count = upper_bound(positions.begin(), positions.end(), end)
+			- lower_bound(positions.begin(), positions.end(), start);
+	int n_start = n->get_preorder_number();
+	if (start < n_start && n_start <= end)
+		count -= subtree_count;
+	return count;
+}
+
+/* where n's subtree attaches when it is the sibling of v, in the tree
+	 without n's subtree restricted to positions. Returns the node whose
+	 leaves in positions are those of the restricted sibling
+*/
+Node *restricted_attachment(Node *n, Node *v, const vector<int> &positions,
+		int subtree_count) {
+	while (restricted_count(n, v, positions, subtree_count) == 0)
+		v = v->parent();
+	while (!v->is_leaf()) {
+		Node *next = NULL;
+		int num_next = 0;
+		list<Node *>::iterator c;
+		for(c = v->get_children().begin(); c != v->get_children().end(); c++) {
+			if (*c != n
+					&& restricted_count(n, *c, positions, subtree_count) > 0) {
+				next = *c;
+				num_next++;
+			}
+		}
+		if (num_next != 1)
+			break;
+		v = next;
+	}
+	return v;
+}
+
+/* true if moving n to be the sibling of new_sibling leaves the supertree
+	 restricted to the sorted preorder positions unchanged, so the distance
+	 to a gene tree on those leaves is unchanged. The supertree must be
+	 numbered as it was when the positions were found
+*/
+bool spr_preserves_restriction(Node *n, Node *new_sibling,
+		const vector<int> &positions) {
+	int subtree_count = upper_bound(positions.begin(), positions.end(),
+			last_preorder_number(n))
+			- lower_bound(positions.begin(), positions.end(),
+			n->get_preorder_number());
+	if (subtree_count == 0 || subtree_count == positions.size())
+		return true;
+	return restricted_attachment(n, n->get_sibling(), positions, subtree_count)
+			== restricted_attachment(n, new_sibling, positions, subtree_count);
+}
+
 void find_best_spr_r(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling, int r) {
 	find_best_spr_r(super_tree, gene_trees, best_spr_move, best_sibling,
 			r, NULL);
 }
 void find_best_spr_r(Node *super_tree, vector<Node *> &gene_trees, Node *&best_spr_move, Node *&best_sibling, int r, vector<int> *original_scores) {
+	if (PARALLEL_MOVES) {
+		find_best_spr_r_parallel(super_tree, gene_trees, best_spr_move,
+				best_sibling, r, original_scores);
+		return;
+	}
 	int min_distance = INT_MAX;
 	int min_tie_distance = INT_MAX;
 	int num_ties = 0;
+	vector<vector<int> > positions = vector<vector<int> >();
+	if (original_scores != NULL) {
+		super_tree->preorder_number();
+		restricted_positions(super_tree, gene_trees, &positions);
+	}
 	find_best_spr_r_helper(super_tree, super_tree, gene_trees,
 			best_spr_move, best_sibling, min_distance, min_tie_distance,
-			num_ties, r, original_scores);
+			num_ties, r, original_scores, &positions);
+}
+
+/* find_best_spr_r with the sources split between threads, each with its
+	 own copy of the supertree. The threads share the best distance found
+	 so far, and stop scoring a move once it is worse. Ties go to the
+	 first move in the order of the serial search
+*/
+void find_best_spr_r_parallel(Node *super_tree, vector<Node *> &gene_trees,
+		Node *&best_spr_move, Node *&best_sibling, int r,
+		vector<int> *original_scores) {
+	super_tree->set_depth(0);
+	super_tree->fix_depths();
+	super_tree->preorder_number();
+	// the copies of the supertree are numbered the same
+	vector<vector<int> > positions = vector<vector<int> >();
+	if (original_scores != NULL)
+		restricted_positions(super_tree, gene_trees, &positions);
+	// the serial search visits the sources in postorder
+	vector<Node *> sources = super_tree->find_descendants();
+	vector<pair<int, int> > order = vector<pair<int, int> >();
+	for(int i = 0; i < sources.size(); i++)
+		order.push_back(make_pair(last_preorder_number(sources[i]),
+				-sources[i]->get_preorder_number()));
+	sort(order.begin(), order.end());
+	int num_sources = order.size();
+	vector<int> source_distances = vector<int>(num_sources, INT_MAX);
+	vector<int> source_tie_distances = vector<int>(num_sources, INT_MAX);
+	vector<int> source_siblings = vector<int>(num_sources, -1);
+	SHARED_MIN_DISTANCE = INT_MAX;
+	int num_done = 0;
+	RsprContext *context = rspr_context();
+	#pragma omp parallel
+	{
+		RsprContextCopy thread_context(context);
+		Node *tree = new Node(*super_tree);
+		tree->set_depth(0);
+		tree->fix_depths();
+		tree->preorder_number();
+		#pragma omp for schedule(dynamic, 1)
+		for(int i = 0; i < num_sources; i++) {
+			Node *n = tree->find_by_prenum(-order[i].second);
+			Node *move = NULL;
+			Node *sibling = NULL;
+			int min_distance = INT_MAX;
+			int min_tie_distance = INT_MAX;
+			int num_ties = 0;
+			find_best_spr_r_source(n, tree, gene_trees, move, sibling,
+					min_distance, min_tie_distance, num_ties, r, original_scores,
+					&positions);
+			if (move != NULL) {
+				source_distances[i] = min_distance;
+				source_tie_distances[i] = min_tie_distance;
+				source_siblings[i] = sibling->get_preorder_number();
+			}
+			#pragma omp critical(spr_supertree_progress)
+			{
+				num_done++;
+				cout << "\r \r" << num_done << "/" << num_sources << flush;
+			}
+		}
+		tree->delete_tree();
+	}
+	int best = -1;
+	for(int i = 0; i < num_sources; i++) {
+		if (source_siblings[i] < 0)
+			continue;
+		if (best == -1 || source_distances[i] < source_distances[best]
+				|| (RF_TIES && source_distances[i] == source_distances[best]
+					&& source_tie_distances[i] < source_tie_distances[best]))
+			best = i;
+	}
+	if (best >= 0) {
+		best_spr_move = super_tree->find_by_prenum(-order[best].second);
+		best_sibling = super_tree->find_by_prenum(source_siblings[best]);
+	}
 }
 
 void find_best_spr_r_helper(Node *n, Node *super_tree,
@@ -3705,31 +4027,46 @@ void find_best_spr_r_helper(Node *n, Node *super_tree,
 		Node *&best_sibling, int &min_distance, int &num_ties, int r) {
 	int min_tie_distance = INT_MAX;
 	find_best_spr_r_helper(n, super_tree, gene_trees, best_spr_move,
-			best_sibling, min_distance, min_tie_distance, num_ties, r, NULL);
+			best_sibling, min_distance, min_tie_distance, num_ties, r, NULL,
+			NULL);
 }
 
 void find_best_spr_r_helper(Node *n, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
 		Node *&best_sibling, int &min_distance, int &min_tie_distance,
-		int &num_ties, int r, vector<int> *original_scores) {
+		int &num_ties, int r, vector<int> *original_scores,
+		vector<vector<int> > *positions) {
 
 	if (n->lchild() != NULL) {
 		find_best_spr_r_helper(n->lchild(), super_tree,
 				gene_trees, best_spr_move, best_sibling, min_distance,
-				min_tie_distance, num_ties, r, original_scores);
+				min_tie_distance, num_ties, r, original_scores, positions);
 	}
 	if (n->rchild() != NULL) {
 		find_best_spr_r_helper(n->rchild(), super_tree,
 				gene_trees, best_spr_move, best_sibling, min_distance,
-				min_tie_distance, num_ties, r, original_scores);
+				min_tie_distance, num_ties, r, original_scores, positions);
 	}
-	vector<Node *> current_gene_trees;
-	vector<Node *> *gene_trees_p = &gene_trees;
-	int offset = 0;
 	if (C_SOURCE != 1)
 		cout << "\r \r";
 	cout << C_SOURCE << "/" << NUM_SOURCE << flush;
 	C_SOURCE++;
+	find_best_spr_r_source(n, super_tree, gene_trees, best_spr_move,
+			best_sibling, min_distance, min_tie_distance, num_ties, r,
+			original_scores, positions);
+}
+
+// consider the moves of n's subtree
+void find_best_spr_r_source(Node *n, Node *super_tree,
+		vector<Node *> &gene_trees, Node *&best_spr_move,
+		Node *&best_sibling, int &min_distance, int &min_tie_distance,
+		int &num_ties, int r, vector<int> *original_scores,
+		vector<vector<int> > *positions) {
+	vector<Node *> current_gene_trees;
+	vector<Node *> *gene_trees_p = &gene_trees;
+	int offset = 0;
+	GeneTreeScores cached_scores = GeneTreeScores();
+	GeneTreeScores *cached_scores_p = NULL;
 	
 	// TODO: check here if there will be any moves
 	// if not, then we do not need to look at the gene trees
@@ -3745,13 +4082,17 @@ void find_best_spr_r_helper(Node *n, Node *super_tree,
 					break;
 				}
 			}
-			if (include)
+			if (include) {
 					current_gene_trees.push_back(gene_trees[i]);
+					cached_scores.scores.push_back((*original_scores)[i]);
+					cached_scores.positions.push_back(&(*positions)[i]);
+			}
 			else {
 				offset += (*original_scores)[i];
 			}
 		}
 		gene_trees_p = &current_gene_trees;
+		cached_scores_p = &cached_scores;
 //		cout << "gene_trees: " << gene_trees.size() << endl;
 //		cout << "c_gene_trees: " << current_gene_trees.size() << endl;
 	}
@@ -3766,11 +4107,11 @@ void find_best_spr_r_helper(Node *n, Node *super_tree,
 		if(n->parent()->lchild() == n)
 			find_best_spr_r_helper(n, n->parent(), super_tree, *gene_trees_p,
 					best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, r+1, 1, offset);
+					num_ties, r+1, 1, offset, cached_scores_p);
 		else if(n->parent()->rchild() == n)
 			find_best_spr_r_helper(n, n->parent(), super_tree, *gene_trees_p,
 					best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, r+1, 2, offset);
+					num_ties, r+1, 2, offset, cached_scores_p);
 	}
 
 }
@@ -3782,7 +4123,7 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 	int min_tie_distance = INT_MAX;
 	find_best_spr_r_helper(n, new_sibling, super_tree, gene_trees,
 			best_spr_move, best_sibling, min_distance, min_tie_distance,
-			num_ties, r, origin, 0);
+			num_ties, r, origin, 0, NULL);
 }
 
 /*
@@ -3793,7 +4134,8 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 		vector<Node *> &gene_trees, Node *&best_spr_move,
 		Node *&best_sibling, int &min_distance, int &min_tie_distance,
-		int &num_ties, int r, int origin, int offset) {
+		int &num_ties, int r, int origin, int offset,
+		GeneTreeScores *cached_scores) {
 	// do not consider invalid spr moves to n's subtree
 	if (new_sibling == n)
 		return;
@@ -3812,12 +4154,12 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 					|| new_sibling->parent()->parent() == NULL)) {//!new_sibling->is_protected())){
 			if(new_sibling->parent()->lchild() == new_sibling){
 				find_best_spr_r_helper(n, new_sibling->parent(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-						num_ties, --r, 1, offset);	
+						num_ties, --r, 1, offset, cached_scores);	
 				//cout << "Origin1, Target: " << new_sibling->parent()->str_subtree() << endl;
 			}
 			else{
 				find_best_spr_r_helper(n, new_sibling->parent(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-						num_ties, --r, 2, offset);	
+						num_ties, --r, 2, offset, cached_scores);	
 				//cout << "Origin1, Target: " << new_sibling->parent()->str_subtree() << endl;
 			}
 		}
@@ -3827,7 +4169,7 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 			//cout << "Going to Origin 3\n";
 			//cout << "n to 3: " << n->str_subtree() << "\tsibling to 3: " << new_sibling->rchild()->str_subtree() << endl;
 			find_best_spr_r_helper(n, new_sibling->rchild(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, --r, 3, offset);
+					num_ties, --r, 3, offset, cached_scores);
 			//cout << "Origin1, Target: " << new_sibling->rchild()->str_subtree() << endl;
 		}
 
@@ -3840,12 +4182,12 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 					|| new_sibling->parent()->parent() == NULL)) {//!new_sibling->is_protected())){
 			if(new_sibling->parent()->lchild() == new_sibling){
 				find_best_spr_r_helper(n, new_sibling->parent(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-						num_ties, --r, 1, offset);
+						num_ties, --r, 1, offset, cached_scores);
 				//cout << "Origin2, Target: " << new_sibling->parent()->str_subtree() << endl;	
 			}			
 			else{
 				find_best_spr_r_helper(n, new_sibling->parent(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-						num_ties, --r, 2, offset);	
+						num_ties, --r, 2, offset, cached_scores);	
 				//cout << "Origin2, Target: " << new_sibling->parent()->str_subtree() << endl;	
 			}
 		}		
@@ -3856,7 +4198,7 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 			//cout << "n to 3: " << n->str_subtree() << "\tsibling to 3: " << new_sibling->lchild()->str_subtree() << endl;
 			//cout << "Origin2, Target: " << new_sibling->lchild()->str_subtree() << endl;
 			find_best_spr_r_helper(n, new_sibling->lchild(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, --r, 3, offset);
+					num_ties, --r, 3, offset, cached_scores);
 		}
 
 	}
@@ -3869,7 +4211,7 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 //						|| !new_sibling->is_protected())){
 				|| new_sibling->get_support() < SUPPORT_THRESHOLD)) {//!new_sibling->is_protected())){
 			find_best_spr_r_helper(n, new_sibling->lchild(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, --r, 3, offset);
+					num_ties, --r, 3, offset, cached_scores);
 			//cout << "Origin3, Target: " << new_sibling->lchild()->str_subtree() << endl;
 		}
 		if(new_sibling->rchild() != NULL
@@ -3877,7 +4219,7 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 //						|| !new_sibling->is_protected())){
 				|| new_sibling->get_support() < SUPPORT_THRESHOLD)) {//!new_sibling->is_protected())){
 			find_best_spr_r_helper(n, new_sibling->rchild(), super_tree, gene_trees, best_spr_move, best_sibling, min_distance, min_tie_distance,
-					num_ties, --r, 3, offset);
+					num_ties, --r, 3, offset, cached_scores);
 			//cout << "Origin3, Target: " << new_sibling->rchild()->str_subtree() << endl;
 		}
 	}
@@ -3921,6 +4263,21 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 //		cout << endl;
 //		cout << "Previous Super Tree: "
 //		<< super_tree->str_support_subtree(true) << endl;
+		// gene trees that the move does not change keep their distance
+		vector<Node *> changed_gene_trees;
+		vector<Node *> *scored_gene_trees = &gene_trees;
+		int unchanged_offset = 0;
+		if (cached_scores != NULL) {
+			changed_gene_trees = vector<Node *>();
+			for(int i = 0; i < gene_trees.size(); i++) {
+				if (spr_preserves_restriction(n, new_sibling,
+						*cached_scores->positions[i]))
+					unchanged_offset += cached_scores->scores[i];
+				else
+					changed_gene_trees.push_back(gene_trees[i]);
+			}
+			scored_gene_trees = &changed_gene_trees;
+		}
 		int which_sibling = 0;
 		Node *undo = n->spr(new_sibling, which_sibling);
 		super_tree->set_depth(0);
@@ -3933,24 +4290,37 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 		cout << "Proposed Super Tree: " << super_tree->str_subtree() << endl;
 		super_tree->labels_to_numbers(&label_map, &reverse_label_map);
 */	
+		// moves that can not tie the best so far are not scored exactly
+		int threshold = min_distance;
+		if (PARALLEL_MOVES) {
+			#pragma omp critical(spr_supertree_best)
+			{
+				if (SHARED_MIN_DISTANCE < threshold)
+					threshold = SHARED_MIN_DISTANCE;
+			}
+		}
+		if (threshold < INT_MAX)
+			threshold -= offset + unchanged_offset;
 		int distance;
 		if (APPROX) {
 			if (UNROOTED)
-				distance = rSPR_total_approx_distance_unrooted(super_tree, gene_trees);
+				distance = rSPR_total_approx_distance_unrooted(super_tree, *scored_gene_trees);
 			else
-				distance = rSPR_total_approx_distance(super_tree, gene_trees);
+				distance = rSPR_total_approx_distance(super_tree, *scored_gene_trees);
 		}
 		else {
 			if (UNROOTED)
-				distance = rSPR_total_distance_unrooted(super_tree, gene_trees);
+				distance = rSPR_total_distance_unrooted(super_tree,
+						*scored_gene_trees, threshold);
 			else
-				distance = rSPR_total_distance(super_tree, gene_trees);
+				distance = rSPR_total_distance(super_tree, *scored_gene_trees,
+						threshold);
 		}
 //		cout << "\t" << distance << endl;
 
 //		cout << "After SPR Distance Super Tree: "
 //		<< super_tree->str_support_subtree(true) << endl;
-		distance += offset;
+		distance += offset + unchanged_offset;
 		if (distance < min_distance) {
 			if (!TABOO_SEARCH || !is_taboo(taboo_trees, super_tree)) {
 				min_distance = distance;
@@ -3980,7 +4350,8 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 				else
 					check_tie = false;
 			}
-			if (check_tie) {
+			// the parallel search keeps the first of tied moves
+			if (check_tie && !PARALLEL_MOVES) {
 				int r = rand();
 				if (r < RAND_MAX/num_ties) {
 					if (!TABOO_SEARCH || !is_taboo(taboo_trees, super_tree)) {
@@ -3992,6 +4363,13 @@ void find_best_spr_r_helper(Node *n, Node *new_sibling, Node *super_tree,
 				num_ties++;
 			}
 		}
+		if (PARALLEL_MOVES) {
+			#pragma omp critical(spr_supertree_best)
+			{
+				if (min_distance < SHARED_MIN_DISTANCE)
+					SHARED_MIN_DISTANCE = min_distance;
+			}
+		}
 		// restore the previous tree
 		n->spr(undo, which_sibling);
 
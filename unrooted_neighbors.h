@@ -0,0 +1,381 @@
+#ifndef INCLUDE_UNROOTED_NEIGHBORS
+#define INCLUDE_UNROOTED_NEIGHBORS
+
+// INCLUDES
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <list>
+#include <time.h>
+
+#include "Node.h"
+
+using namespace std;
+
+/*
+	Native unrooted NNI, SPR and TBR neighborhoods.
+
+	An unrooted tree is stored as an adjacency list over integer node
+	ids. A binary root from the Node representation is suppressed when
+	the tree is built, and a node left without neighbors by an operation
+	is simply ignored. Moves are applied to the adjacency list and undone
+	in place, so no rerooting or copying of Node trees is needed.
+
+	The canonical key of an unrooted tree is the rooted string obtained
+	by placing the root on the edge of the smallest leaf and ordering
+	children by their smallest descendant leaf, as in
+	Node::normalize_order. Keys are valid trees for build_tree.
+*/
+
+// CLASSES
+
+class UnrootedTree {
+	public:
+	vector<vector<int> > adj;
+	// leaf label number, -1 for internal nodes
+	vector<int> label;
+
+	UnrootedTree(Node *tree) {
+		adj = vector<vector<int> >();
+		label = vector<int>();
+		int root = add_node(tree);
+		if (adj[root].size() == 2) {
+			int a = adj[root][0];
+			int b = adj[root][1];
+			remove_edge(root, a);
+			remove_edge(root, b);
+			add_edge(a, b);
+		}
+	}
+
+	int add_node(Node *n) {
+		int id = adj.size();
+		adj.push_back(vector<int>());
+		if (n->is_leaf())
+			label.push_back(n->get_name_num());
+		else
+			label.push_back(-1);
+		list<Node *>::iterator c;
+		for(c = n->get_children().begin(); c != n->get_children().end(); c++) {
+			int child = add_node(*c);
+			add_edge(id, child);
+		}
+		return id;
+	}
+
+	int size() {
+		return adj.size();
+	}
+
+	bool is_leaf(int x) {
+		return label[x] >= 0;
+	}
+
+	void add_edge(int a, int b) {
+		adj[a].push_back(b);
+		adj[b].push_back(a);
+	}
+
+	void remove_edge(int a, int b) {
+		adj[a].erase(find(adj[a].begin(), adj[a].end(), b));
+		adj[b].erase(find(adj[b].begin(), adj[b].end(), a));
+	}
+
+	// the edges reachable from x without crossing from
+	void find_edges(int x, int from, vector<pair<int, int> > &edges) {
+		for(int i = 0; i < adj[x].size(); i++) {
+			int y = adj[x][i];
+			if (y != from) {
+				edges.push_back(make_pair(x, y));
+				find_edges(y, x, edges);
+			}
+		}
+	}
+
+	string str() {
+		int min_leaf = -1;
+		for(int i = 0; i < adj.size(); i++) {
+			if (is_leaf(i) && !adj[i].empty() &&
+					(min_leaf == -1 || label[i] < label[min_leaf]))
+				min_leaf = i;
+		}
+		if (min_leaf == -1)
+			return "";
+		string s = "";
+		str_hlpr(adj[min_leaf][0], min_leaf, &s);
+		stringstream ss;
+		ss << label[min_leaf];
+		return "(" + ss.str() + "," + s + ")";
+	}
+
+	// writes the subtree of x away from from and returns its smallest leaf
+	int str_hlpr(int x, int from, string *s) {
+		if (is_leaf(x)) {
+			stringstream ss;
+			ss << label[x];
+			*s += ss.str();
+			return label[x];
+		}
+		map<int, string> ordered_children = map<int, string>();
+		for(int i = 0; i < adj[x].size(); i++) {
+			int y = adj[x][i];
+			if (y != from) {
+				string child = "";
+				int min_descendant = str_hlpr(y, x, &child);
+				ordered_children.insert(make_pair(min_descendant, child));
+			}
+		}
+		*s += "(";
+		map<int, string>::iterator c;
+		for(c = ordered_children.begin(); c != ordered_children.end(); c++) {
+			if (c != ordered_children.begin())
+				*s += ",";
+			*s += c->second;
+		}
+		*s += ")";
+		return ordered_children.begin()->first;
+	}
+};
+
+// FUNCTIONS
+
+string unrooted_str(Node *tree);
+list<Node *> get_unrooted_nni_neighbors(Node *tree);
+list<Node *> get_unrooted_nni_neighbors(Node *tree, set<string> &known_trees);
+list<Node *> get_unrooted_spr_neighbors(Node *tree);
+list<Node *> get_unrooted_spr_neighbors(Node *tree, set<string> &known_trees);
+list<Node *> get_tbr_neighbors(Node *tree);
+list<Node *> get_tbr_neighbors(Node *tree, set<string> &known_trees);
+void add_unrooted_neighbor(UnrootedTree &t, list<Node *> &neighbors,
+		set<string> &known_trees);
+
+// canonical unrooted key of a rooted or unrooted Node tree
+string unrooted_str(Node *tree) {
+	UnrootedTree t = UnrootedTree(tree);
+	return t.str();
+}
+
+void add_unrooted_neighbor(UnrootedTree &t, list<Node *> &neighbors,
+		set<string> &known_trees) {
+	string name = t.str();
+	if (known_trees.find(name) == known_trees.end()) {
+		known_trees.insert(name);
+		Node *new_tree = build_tree(name);
+		new_tree->preorder_number();
+		neighbors.push_back(new_tree);
+	}
+}
+
+list<Node *> get_unrooted_nni_neighbors(Node *tree) {
+	set<string> known_trees = set<string>();
+	known_trees.insert(unrooted_str(tree));
+	return get_unrooted_nni_neighbors(tree, known_trees);
+}
+
+// swap one subtree from each side of every internal edge
+list<Node *> get_unrooted_nni_neighbors(Node *tree, set<string> &known_trees) {
+	list<Node *> neighbors = list<Node *>();
+	UnrootedTree t = UnrootedTree(tree);
+	for(int u = 0; u < t.size(); u++) {
+		if (t.is_leaf(u) || t.adj[u].size() != 3)
+			continue;
+		// swaps reorder adj[u], so iterate over a copy
+		vector<int> u_adj = t.adj[u];
+		for(int i = 0; i < 3; i++) {
+			int v = u_adj[i];
+			if (v < u || t.is_leaf(v) || t.adj[v].size() != 3)
+				continue;
+			// a is the first neighbor of u other than v
+			int a = u_adj[(i+1)%3];
+			vector<int> v_side = vector<int>();
+			for(int j = 0; j < 3; j++) {
+				if (t.adj[v][j] != u)
+					v_side.push_back(t.adj[v][j]);
+			}
+			for(int j = 0; j < v_side.size(); j++) {
+				int c = v_side[j];
+				t.remove_edge(u, a);
+				t.remove_edge(v, c);
+				t.add_edge(u, c);
+				t.add_edge(v, a);
+				add_unrooted_neighbor(t, neighbors, known_trees);
+				t.remove_edge(u, c);
+				t.remove_edge(v, a);
+				t.add_edge(u, a);
+				t.add_edge(v, c);
+			}
+		}
+	}
+	return neighbors;
+}
+
+list<Node *> get_unrooted_spr_neighbors(Node *tree) {
+	set<string> known_trees = set<string>();
+	known_trees.insert(unrooted_str(tree));
+	return get_unrooted_spr_neighbors(tree, known_trees);
+}
+
+/* prune the subtree on the v side of each edge (u,v) with u internal,
+	 suppress u and regraft it onto every other edge of the remaining tree
+*/
+list<Node *> get_unrooted_spr_neighbors(Node *tree, set<string> &known_trees) {
+	list<Node *> neighbors = list<Node *>();
+	UnrootedTree t = UnrootedTree(tree);
+	for(int u = 0; u < t.size(); u++) {
+		if (t.is_leaf(u) || t.adj[u].size() != 3)
+			continue;
+		for(int i = 0; i < 3; i++) {
+			int v = t.adj[u][i];
+			int a = t.adj[u][(i+1)%3];
+			int b = t.adj[u][(i+2)%3];
+			// prune
+			t.remove_edge(u, a);
+			t.remove_edge(u, b);
+			t.add_edge(a, b);
+			vector<pair<int, int> > edges = vector<pair<int, int> >();
+			t.find_edges(a, -1, edges);
+			// regraft
+			for(int j = 0; j < edges.size(); j++) {
+				int x = edges[j].first;
+				int y = edges[j].second;
+				if ((x == a && y == b) || (x == b && y == a))
+					continue;
+				t.remove_edge(x, y);
+				t.add_edge(x, u);
+				t.add_edge(u, y);
+				add_unrooted_neighbor(t, neighbors, known_trees);
+				t.remove_edge(x, u);
+				t.remove_edge(u, y);
+				t.add_edge(x, y);
+			}
+			// restore, keeping the neighbor order of u
+			t.remove_edge(a, b);
+			t.remove_edge(u, v);
+			t.adj[u].clear();
+			t.adj[u].resize(3);
+			t.adj[u][i] = v;
+			t.adj[u][(i+1)%3] = a;
+			t.adj[u][(i+2)%3] = b;
+			t.adj[v].push_back(u);
+			t.adj[a].push_back(u);
+			t.adj[b].push_back(u);
+		}
+	}
+	return neighbors;
+}
+
+list<Node *> get_tbr_neighbors(Node *tree) {
+	set<string> known_trees = set<string>();
+	known_trees.insert(unrooted_str(tree));
+	return get_tbr_neighbors(tree, known_trees);
+}
+
+/* cut each edge (u,v), suppress its endpoints and reconnect the two
+	 components by every pair of attachment points. An attachment point
+	 is an edge of the component, or the component itself if it is a
+	 single leaf
+*/
+list<Node *> get_tbr_neighbors(Node *tree, set<string> &known_trees) {
+	list<Node *> neighbors = list<Node *>();
+	UnrootedTree t = UnrootedTree(tree);
+	for(int u = 0; u < t.size(); u++) {
+		for(int i = 0; i < t.adj[u].size(); i++) {
+			int v = t.adj[u][i];
+			if (v < u)
+				continue;
+			if ((!t.is_leaf(u) && t.adj[u].size() != 3) ||
+					(!t.is_leaf(v) && t.adj[v].size() != 3))
+				continue;
+			t.remove_edge(u, v);
+			vector<int> u_old = t.adj[u];
+			vector<int> v_old = t.adj[v];
+			vector<pair<int, int> > u_edges = vector<pair<int, int> >();
+			vector<pair<int, int> > v_edges = vector<pair<int, int> >();
+			// suppress the endpoints
+			if (t.is_leaf(u))
+				u_edges.push_back(make_pair(-1, -1));
+			else {
+				t.remove_edge(u, u_old[0]);
+				t.remove_edge(u, u_old[1]);
+				t.add_edge(u_old[0], u_old[1]);
+				t.find_edges(u_old[0], -1, u_edges);
+			}
+			if (t.is_leaf(v))
+				v_edges.push_back(make_pair(-1, -1));
+			else {
+				t.remove_edge(v, v_old[0]);
+				t.remove_edge(v, v_old[1]);
+				t.add_edge(v_old[0], v_old[1]);
+				t.find_edges(v_old[0], -1, v_edges);
+			}
+			// reconnect
+			for(int j = 0; j < u_edges.size(); j++) {
+				int ux = u_edges[j].first;
+				int uy = u_edges[j].second;
+				bool u_same = t.is_leaf(u) ||
+						(ux == u_old[0] && uy == u_old[1]) ||
+						(ux == u_old[1] && uy == u_old[0]);
+				if (ux != -1) {
+					t.remove_edge(ux, uy);
+					t.add_edge(ux, u);
+					t.add_edge(u, uy);
+				}
+				for(int k = 0; k < v_edges.size(); k++) {
+					int vx = v_edges[k].first;
+					int vy = v_edges[k].second;
+					bool v_same = t.is_leaf(v) ||
+							(vx == v_old[0] && vy == v_old[1]) ||
+							(vx == v_old[1] && vy == v_old[0]);
+					if (u_same && v_same)
+						continue;
+					if (vx != -1) {
+						t.remove_edge(vx, vy);
+						t.add_edge(vx, v);
+						t.add_edge(v, vy);
+					}
+					t.add_edge(u, v);
+					add_unrooted_neighbor(t, neighbors, known_trees);
+					t.remove_edge(u, v);
+					if (vx != -1) {
+						t.remove_edge(vx, v);
+						t.remove_edge(v, vy);
+						t.add_edge(vx, vy);
+					}
+				}
+				if (ux != -1) {
+					t.remove_edge(ux, u);
+					t.remove_edge(u, uy);
+					t.add_edge(ux, uy);
+				}
+			}
+			// restore
+			if (!t.is_leaf(u)) {
+				t.remove_edge(u_old[0], u_old[1]);
+				t.add_edge(u, u_old[0]);
+				t.add_edge(u, u_old[1]);
+			}
+			if (!t.is_leaf(v)) {
+				t.remove_edge(v_old[0], v_old[1]);
+				t.add_edge(v, v_old[0]);
+				t.add_edge(v, v_old[1]);
+			}
+			// put v back at position i so the loop over adj[u] continues
+			t.adj[u].insert(t.adj[u].begin() + i, v);
+			t.adj[v].push_back(u);
+		}
+	}
+	return neighbors;
+}
+
+#endif